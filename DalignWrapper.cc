@@ -18,20 +18,44 @@ void DalignWrapper::SetAligningParameters(float corelation, int traceSpacing, co
 }
 
 bool DalignWrapper::ComputeAlignment(Sequence& A, Sequence& B, pair<int, int> seed, Alignment& al) {
-    if (workData == NULL || alignSpec == NULL) {
+    return ComputeAlignment(A, B, seed, al, workData);
+}
+
+bool DalignWrapper::ComputeAlignment(Sequence& A, Sequence& B, pair<int, int> seed, Alignment& al,
+                                     dalign::Work_Data* data) {
+    if (data == NULL || alignSpec == NULL) {
         return false;
     }
-    al.Prepare(A, B, workData, dalign::Trace_Spacing(alignSpec));
-    dalign::Local_Alignment(&(al.alignment), workData, alignSpec, seed.first, seed.first, seed.second);
+    al.Prepare(A, B, data, dalign::Trace_Spacing(alignSpec));
+    dalign::Local_Alignment(&(al.alignment), data, alignSpec, seed.first, seed.first, seed.second);
     al.status = Alignment::AS_ALIGNMENT;
     return true;
 }
 
+dalign::Work_Data* DalignWrapper::AcquireWorkData() {
+    lock_guard<mutex> lock(freeWorkDataMutex);
+    if (freeWorkData.empty()) {
+        return dalign::New_Work_Data();
+    }
+    dalign::Work_Data* data = freeWorkData.back();
+    freeWorkData.pop_back();
+    return data;
+}
+
+void DalignWrapper::ReleaseWorkData(dalign::Work_Data* data) {
+    lock_guard<mutex> lock(freeWorkDataMutex);
+    freeWorkData.push_back(data);
+}
+
 void DalignWrapper::FreeDalignData() {
     if (workData != NULL) {
         dalign::Free_Work_Data(workData);
         workData = NULL;
     }
+    for (auto data : freeWorkData) {
+        dalign::Free_Work_Data(data);
+    }
+    freeWorkData.clear();
     if (alignSpec != NULL) {
         dalign::Free_Align_Spec(alignSpec);
         alignSpec = NULL;
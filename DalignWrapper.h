@@ -1,6 +1,7 @@
 #pragma once
 //#include "common.h"
 #include <array>
+#include <mutex>
 #include <vector>
 #include "Sequence.h"
 namespace dalign {
@@ -55,8 +56,23 @@ public:
 
     void SetAligningParameters(float corelation, int traceSpacing, const array<float, 4>& frequencies);
     bool ComputeAlignment(Sequence& A, Sequence& B, pair<int, int> seed, Alignment& al);
+
+    // Align_Spec is read only and shared, every thread aligning at once
+    // needs its own Work_Data. These two are thread safe, released work
+    // data are kept for reuse until SetAligningParameters or destruction.
+    dalign::Work_Data* AcquireWorkData();
+    void ReleaseWorkData(dalign::Work_Data* data);
+    // Same as above with work data from AcquireWorkData, which al keeps
+    // using (for ComputeTrace) until it is released.
+    bool ComputeAlignment(Sequence& A, Sequence& B, pair<int, int> seed, Alignment& al,
+                          dalign::Work_Data* data);
 private:
+    DalignWrapper(const DalignWrapper&);
+    DalignWrapper& operator=(const DalignWrapper&);
+
     void FreeDalignData();
     dalign::Work_Data* workData;
     dalign::Align_Spec* alignSpec;
+    mutex freeWorkDataMutex;
+    vector<dalign::Work_Data*> freeWorkData;
 };
\ No newline at end of file
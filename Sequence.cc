@@ -93,34 +93,20 @@ FASTA& FASTA::operator>>(Sequence& seq) {
 }
 
 FASTQ::FASTQ(const string& filename)
-: is(filename.c_str()), isOk(true) {
+: reader(filename), isOk(reader.good()) {
 }
 
 FASTQ& FASTQ::operator>>(Sequence& seq) {
-    string data;
-    string id;
-    string line;
-    
+    FastxRecord record;
     if (isOk) {
-        isOk &= (bool)getline(is, line);
-        if (line.length()) {
-            id = line.substr(1, line.length() - 1);
-        }
+        isOk = reader.Next(record);
     }
     if (isOk) {
-        isOk &= (bool)getline(is, line);
-        for (char c : line) {
-            data.push_back(ToUpperCase(c));
+        string data(record.seq, record.seq_length);
+        for (char& c : data) {
+            c = ToUpperCase(c);
         }
-    }
-    if (isOk) {
-        isOk &= (bool)getline(is, line);
-    }
-    if (isOk) {
-        isOk &= (bool)getline(is, line);
-    }
-    if (isOk) {
-        seq = Sequence(data, id);
+        seq = Sequence(data, record.Name());
     }
     else {
         seq = Sequence();
@@ -1,6 +1,7 @@
 #pragma once
 //#include "common.h"
 #include <fstream>
+#include "fastx_reader.h"
 
 using namespace std;
 
@@ -44,7 +45,7 @@ public:
         return isOk;
     };
 private:
-    ifstream is;
+    FastxReader reader;
     bool isOk;
 };
 
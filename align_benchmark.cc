@@ -0,0 +1,80 @@
+#include "read_set.h"
+#include "util.h"
+#include <chrono>
+#include <sstream>
+
+// Compares verification engines of ReadSet on random genome and reads
+// with a few errors. Then measures BatchedAligner alone on every supported
+// instruction set, without candidate search and window copying, which take
+// most of the time of GetAlignments.
+// Usage: align_benchmark [genome_length] [num_reads] [read_length]
+int main(int argc, char** argv) {
+  int genome_length = argc > 1 ? atoi(argv[1]) : 200000;
+  int num_reads = argc > 2 ? atoi(argv[2]) : 20000;
+  int read_length = argc > 3 ? atoi(argv[3]) : 100;
+
+  srand(47);
+  char alph[] = "ACGT";
+  string genome;
+  for (int i = 0; i < genome_length; i++) {
+    genome += alph[rand()%4];
+  }
+  stringstream reads;
+  // Windows around true positions of reads, as verification gets them
+  PackedReadStore packed_reads;
+  vector<string> windows;
+  vector<int> expected_starts;
+  const int margin = 12;
+  for (int i = 0; i < num_reads; i++) {
+    int pos = rand() % (genome_length - read_length);
+    string read = genome.substr(pos, read_length);
+    int errors = rand() % 4;
+    for (int j = 0; j < errors; j++) {
+      read[rand() % read_length] = alph[rand()%4];
+    }
+    int window_start = max(0, pos - margin);
+    windows.push_back(genome.substr(window_start, read_length + 2 * margin));
+    expected_starts.push_back(pos - window_start);
+    packed_reads.Add(read);
+    if (rand()%2) read = ReverseSeq(read);
+    reads << "@r" << i << endl << read << endl << "+" << endl << read << endl;
+  }
+
+  ReadSet<> rs;
+  rs.LoadReadSet(reads);
+
+  const char* names[] = {"bfs", "myers", "batched"};
+  VerificationEngine engines[] = {VERIFY_BFS, VERIFY_MYERS, VERIFY_BATCHED};
+  printf("batched aligner uses %d lanes\n", BatchedAligner().lanes());
+  for (int i = 0; i < 3; i++) {
+    rs.SetVerificationEngine(engines[i]);
+    auto start = chrono::steady_clock::now();
+    vector<ReadAlignment> als = rs.GetAlignments(genome);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    long long total_dist = 0;
+    for (auto &al: als) {
+      total_dist += al.dist;
+    }
+    printf("%s: %.3f s, %d alignments, total distance %lld\n",
+           names[i], seconds, (int) als.size(), total_dist);
+  }
+
+  vector<BandedTask> tasks;
+  for (int i = 0; i < num_reads; i++) {
+    tasks.push_back(BandedTask(packed_reads[i], &windows[i], expected_starts[i]));
+  }
+  const char* level_names[] = {"scalar", "sse4.1", "avx2"};
+  for (int level = SIMD_NONE; level <= BatchedAligner::SupportedLevel(); level++) {
+    BatchedAligner aligner((SimdLevel) level);
+    vector<int> dists, starts;
+    auto start = chrono::steady_clock::now();
+    aligner.Align(tasks, 6, dists, starts);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    long long total_dist = 0;
+    for (int d: dists) {
+      total_dist += d;
+    }
+    printf("BatchedAligner %s (%d lanes): %.3f s, total distance %lld\n",
+           level_names[level], aligner.lanes(), seconds, total_dist);
+  }
+}
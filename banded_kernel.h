@@ -0,0 +1,105 @@
+#ifndef BANDED_KERNEL_H__
+#define BANDED_KERNEL_H__
+
+// Banded edit distance DP of BatchedAligner, one read per lane of a vector
+// type. Included by edit_distance*.cc, each compiled for a different
+// instruction set, so it must not call any shared inline code (the linker
+// could pick a copy built for the wrong instruction set).
+//
+// TVec provides: typedef V; kLanes; Load, Store, Set1, AddSat, Min, Eq,
+// AndNot(a, b) = ~a & b and Blend(a, b, mask) = mask ? b : a, all working
+// on unsigned bytes.
+
+#include <cstdint>
+
+// Instantiations for the supported instruction sets, with lanes of 1, 16
+// and 32 reads. Defined in edit_distance.cc, edit_distance_sse41.cc and
+// edit_distance_avx2.cc.
+void BandedAlignLanesScalar(const uint8_t* read_bases, const uint8_t* genome_bases,
+                            const uint8_t* lengths, int max_length, int max_err,
+                            uint8_t* values, uint8_t* starts);
+void BandedAlignLanesSse41(const uint8_t* read_bases, const uint8_t* genome_bases,
+                           const uint8_t* lengths, int max_length, int max_err,
+                           uint8_t* values, uint8_t* starts);
+void BandedAlignLanesAvx2(const uint8_t* read_bases, const uint8_t* genome_bases,
+                          const uint8_t* lengths, int max_length, int max_err,
+                          uint8_t* values, uint8_t* starts);
+
+// Data is transposed, read_bases[i * kLanes + lane] is i-th base of read in
+// lane and genome_bases[j * kLanes + lane] is j-th base of its window, which
+// starts max_err before the expected start. Cells of band are indexed by
+// diagonal d = window_pos - read_pos, d in [0, 2 * max_err]. Stores the last
+// row of each read into values[d * kLanes + lane] (saturated at 255) and
+// window position where its alignment starts into starts[d * kLanes + lane].
+// Preference on ties: diagonal, then gap in genome, then gap in read.
+template<class TVec, int kMaxWidth>
+void BandedAlignLanes(const uint8_t* read_bases, const uint8_t* genome_bases,
+                      const uint8_t* lengths, int max_length, int max_err,
+                      uint8_t* values, uint8_t* starts) {
+  typedef typename TVec::V V;
+  const int lanes = TVec::kLanes;
+  const int width = 2 * max_err + 1;
+
+  V one = TVec::Set1(1);
+  V inf = TVec::Set1(255);
+  V len = TVec::Load(lengths);
+  V rows[4][kMaxWidth + 1];
+  V fin[kMaxWidth];
+  V fin_start[kMaxWidth];
+  V* prev = rows[0];
+  V* cur = rows[1];
+  V* prev_start = rows[2];
+  V* cur_start = rows[3];
+  for (int d = 0; d < width; d++) {
+    prev[d] = TVec::Set1(0);
+    prev_start[d] = TVec::Set1(d);
+    fin[d] = inf;
+    fin_start[d] = TVec::Set1(0);
+  }
+  // Sentinel above the last diagonal
+  prev[width] = inf;
+  cur[width] = inf;
+  prev_start[width] = TVec::Set1(0);
+  cur_start[width] = TVec::Set1(0);
+
+  for (int i = 1; i <= max_length; i++) {
+    V read_base = TVec::Load(read_bases + (i - 1) * lanes);
+    for (int d = 0; d < width; d++) {
+      V genome_base = TVec::Load(genome_bases + (i - 1 + d) * lanes);
+      V mismatch = TVec::AndNot(TVec::Eq(read_base, genome_base), one);
+      V best = TVec::AddSat(prev[d], mismatch);
+      V best_start = prev_start[d];
+      V up = TVec::AddSat(prev[d+1], one);
+      V better = TVec::AndNot(TVec::Eq(TVec::Min(best, up), best), inf);
+      best = TVec::Min(best, up);
+      best_start = TVec::Blend(best_start, prev_start[d+1], better);
+      if (d > 0) {
+        V left = TVec::AddSat(cur[d-1], one);
+        better = TVec::AndNot(TVec::Eq(TVec::Min(best, left), best), inf);
+        best = TVec::Min(best, left);
+        best_start = TVec::Blend(best_start, cur_start[d-1], better);
+      }
+      cur[d] = best;
+      cur_start[d] = best_start;
+    }
+    // Lanes whose read ends at this row keep the row as result.
+    V finished = TVec::Eq(len, TVec::Set1(i));
+    for (int d = 0; d < width; d++) {
+      fin[d] = TVec::Blend(fin[d], cur[d], finished);
+      fin_start[d] = TVec::Blend(fin_start[d], cur_start[d], finished);
+    }
+    V* tmp = prev;
+    prev = cur;
+    cur = tmp;
+    tmp = prev_start;
+    prev_start = cur_start;
+    cur_start = tmp;
+  }
+
+  for (int d = 0; d < width; d++) {
+    TVec::Store(values + d * lanes, fin[d]);
+    TVec::Store(starts + d * lanes, fin_start[d]);
+  }
+}
+
+#endif
@@ -0,0 +1,23 @@
+#include "graph.h"
+#include "graph_snapshot.h"
+#include <cstdio>
+
+// Converts Velvet LastGraph to binary snapshot, which can be given as
+// starting_graph instead of the text graph.
+// Usage: convert_graph <LastGraph> <snapshot>
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    printf("Usage: %s <LastGraph> <snapshot>\n", argv[0]);
+    return 1;
+  }
+  Graph *g = LoadGraph(argv[1]);
+  if (g == NULL) {
+    printf("Cannot load graph %s\n", argv[1]);
+    return 1;
+  }
+  if (!SaveGraphSnapshot(*g, argv[2])) {
+    printf("Cannot write %s\n", argv[2]);
+    return 1;
+  }
+  printf("Wrote %d nodes to %s\n", (int) g->nodes_.size(), argv[2]);
+}
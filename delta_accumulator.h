@@ -0,0 +1,71 @@
+#ifndef DELTA_ACCUMULATOR_H__
+#define DELTA_ACCUMULATOR_H__
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Sums of values grouped by key in [0, size), for rounds that touch only a
+// few keys. Every slot is stamped with the round it was last written in,
+// so starting a new round does not clear the array and grouping is linear
+// in the number of Adds. Meant to be kept and reused between rounds.
+template<class TValue>
+class DeltaAccumulator {
+ public:
+  DeltaAccumulator(size_t size = 0) : epoch_(1) {
+    Resize(size);
+  }
+
+  void Resize(size_t size) {
+    values_.resize(size);
+    stamps_.resize(size, 0);
+  }
+
+  size_t size() const {
+    return values_.size();
+  }
+
+  // Starts a new round, forgets all sums
+  void Clear() {
+    touched_.clear();
+    epoch_++;
+    if (epoch_ == 0) {
+      // Stamps wrapped around
+      stamps_.assign(stamps_.size(), 0);
+      epoch_ = 1;
+    }
+  }
+
+  void Add(int key, const TValue& value) {
+    if (stamps_[key] != epoch_) {
+      stamps_[key] = epoch_;
+      values_[key] = value;
+      touched_.push_back(key);
+      return;
+    }
+    values_[key] += value;
+  }
+
+  bool Contains(int key) const {
+    return stamps_[key] == epoch_;
+  }
+
+  // Valid only for touched keys
+  const TValue& operator[](int key) const {
+    return values_[key];
+  }
+
+  // Keys added in this round, in order of their first Add
+  const vector<int>& touched() const {
+    return touched_;
+  }
+
+ private:
+  vector<TValue> values_;
+  vector<uint32_t> stamps_;
+  vector<int> touched_;
+  uint32_t epoch_;
+};
+
+#endif
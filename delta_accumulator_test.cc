@@ -0,0 +1,36 @@
+#include "delta_accumulator.h"
+#include <gtest/gtest.h>
+
+TEST(DeltaAccumulatorTest, AddTest) {
+  DeltaAccumulator<double> acc(10);
+  acc.Add(7, 1.5);
+  acc.Add(2, 1);
+  acc.Add(7, -0.5);
+  EXPECT_EQ(vector<int>({7, 2}), acc.touched());
+  EXPECT_TRUE(acc.Contains(7));
+  EXPECT_FALSE(acc.Contains(3));
+  EXPECT_DOUBLE_EQ(1.0, acc[7]);
+  EXPECT_DOUBLE_EQ(1.0, acc[2]);
+
+  acc.Clear();
+  EXPECT_TRUE(acc.touched().empty());
+  EXPECT_FALSE(acc.Contains(7));
+  acc.Add(7, 3);
+  EXPECT_EQ(vector<int>({7}), acc.touched());
+  EXPECT_DOUBLE_EQ(3.0, acc[7]);
+}
+
+TEST(DeltaAccumulatorTest, ManyRoundsTest) {
+  DeltaAccumulator<int> acc(5);
+  for (int round = 0; round < 1000; round++) {
+    acc.Clear();
+    for (int i = 0; i <= round % 5; i++) {
+      acc.Add(i, round);
+      acc.Add(i, 1);
+    }
+    ASSERT_EQ(round % 5 + 1, (int) acc.touched().size());
+    for (int key: acc.touched()) {
+      ASSERT_EQ(round + 1, acc[key]);
+    }
+  }
+}
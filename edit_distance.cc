@@ -0,0 +1,254 @@
+#include "edit_distance.h"
+#include "banded_kernel.h"
+#include "util.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+
+void MyersAligner::Scan(const string& genome, int from, int to, int step) {
+  scores_.clear();
+  int last_bit = (length_ - 1) % 64;
+  int score = length_;
+  if (blocks_ == 1) {
+    // Common case of short reads, kept in registers
+    uint64_t pv = ~0ULL;
+    uint64_t mv = 0;
+    for (int j = from; j != to; j += step) {
+      int bits = BaseToBits(genome[j]);
+      uint64_t eq = bits >= 0 ? peq_[bits][0] : 0;
+      uint64_t xv = eq | mv;
+      uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+      uint64_t ph = mv | ~(xh | pv);
+      uint64_t mh = pv & xh;
+      score += (int) ((ph >> last_bit) & 1) - (int) ((mh >> last_bit) & 1);
+      ph <<= 1;
+      mh <<= 1;
+      pv = mh | ~(xv | ph);
+      mv = ph & xv;
+      scores_.push_back(score);
+    }
+    return;
+  }
+
+  pv_.assign(blocks_, ~0ULL);
+  mv_.assign(blocks_, 0);
+  for (int j = from; j != to; j += step) {
+    int bits = BaseToBits(genome[j]);
+    // Horizontal delta entering the block from above, zero in the first
+    // row, because alignment can start anywhere in genome.
+    int hin = 0;
+    for (int b = 0; b < blocks_; b++) {
+      uint64_t eq = bits >= 0 ? peq_[bits][b] : 0;
+      uint64_t pv = pv_[b];
+      uint64_t mv = mv_[b];
+      uint64_t hin_neg = hin < 0 ? 1 : 0;
+      uint64_t xv = eq | mv;
+      eq |= hin_neg;
+      uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+      uint64_t ph = mv | ~(xh | pv);
+      uint64_t mh = pv & xh;
+      if (b == blocks_ - 1) {
+        score += (int) ((ph >> last_bit) & 1) - (int) ((mh >> last_bit) & 1);
+      }
+      int hout = (int) (ph >> 63) - (int) (mh >> 63);
+      ph <<= 1;
+      mh <<= 1;
+      mh |= hin_neg;
+      ph |= hin > 0 ? 1 : 0;
+      pv_[b] = mh | ~(xv | ph);
+      mv_[b] = ph & xv;
+      hin = hout;
+    }
+    scores_.push_back(score);
+  }
+}
+
+bool MyersAligner::FindEnd(const string& genome, int begin, int end,
+                           int expected_end, int max_err, int& best_end,
+                           int& dist) {
+  Scan(genome, begin, end, 1);
+  int best = *min_element(scores_.begin(), scores_.end());
+  if (best > max_err) return false;
+
+  best_end = -1;
+  for (size_t i = 0; i < scores_.size(); i++) {
+    int e = begin + i + 1;
+    if (scores_[i] == best && (best_end == -1 ||
+                               abs(e - expected_end) < abs(best_end - expected_end))) {
+      best_end = e;
+    }
+  }
+  dist = best;
+  return true;
+}
+
+bool MyersAligner::FindStart(const string& genome, int begin, int best_end,
+                             int expected_start, int dist, int& start) {
+  // Reversed read against genome read backwards from best_end gives
+  // distances for all starts.
+  Scan(genome, best_end - 1, begin - 1, -1);
+  int best_start = -1;
+  for (size_t i = 0; i < scores_.size(); i++) {
+    int s = best_end - 1 - i;
+    if (scores_[i] == dist && (best_start == -1 ||
+                               abs(s - expected_start) < abs(best_start - expected_start))) {
+      best_start = s;
+    }
+  }
+  if (best_start == -1) return false;
+
+  start = best_start;
+  return true;
+}
+
+namespace {
+
+struct ScalarVec {
+  typedef uint8_t V;
+  static const int kLanes = 1;
+  static V Load(const uint8_t* p) { return *p; }
+  static void Store(uint8_t* p, V a) { *p = a; }
+  static V Set1(int x) { return x; }
+  static V AddSat(V a, V b) { return min(255, a + b); }
+  static V Min(V a, V b) { return min(a, b); }
+  static V Eq(V a, V b) { return a == b ? 255 : 0; }
+  static V AndNot(V a, V b) { return ~a & b; }
+  static V Blend(V a, V b, V mask) { return mask ? b : a; }
+};
+
+} // namespace
+
+void BandedAlignLanesScalar(const uint8_t* read_bases, const uint8_t* genome_bases,
+                            const uint8_t* lengths, int max_length, int max_err,
+                            uint8_t* values, uint8_t* starts) {
+  BandedAlignLanes<ScalarVec, BatchedAligner::kMaxErrors * 2 + 1>(
+      read_bases, genome_bases, lengths, max_length, max_err, values, starts);
+}
+
+BatchedAligner::BatchedAligner() : level_(SupportedLevel()) {}
+
+BatchedAligner::BatchedAligner(SimdLevel level) : level_(level) {}
+
+SimdLevel BatchedAligner::SupportedLevel() {
+#if defined(__x86_64__) || defined(__i386__)
+  static const SimdLevel level =
+      __builtin_cpu_supports("avx2") ? SIMD_AVX2 :
+      __builtin_cpu_supports("sse4.1") ? SIMD_SSE41 : SIMD_NONE;
+  return level;
+#else
+  return SIMD_NONE;
+#endif
+}
+
+int BatchedAligner::lanes() const {
+  switch (level_) {
+    case SIMD_AVX2: return 32;
+    case SIMD_SSE41: return 16;
+    default: return 1;
+  }
+}
+
+void BatchedAligner::Align(const vector<BandedTask>& tasks, int max_err,
+                           vector<int>& dists, vector<int>& starts) {
+  assert(max_err <= kMaxErrors);
+  dists.resize(tasks.size());
+  starts.resize(tasks.size());
+
+  // Long reads do not fit into lanes, rest is aligned in batches.
+  vector<BandedTask> batch;
+  vector<int> batch_ids;
+  for (size_t i = 0; i < tasks.size(); i++) {
+    const BandedTask& task = tasks[i];
+    if (task.read.size() <= kMaxLength) {
+      batch.push_back(task);
+      batch_ids.push_back(i);
+      continue;
+    }
+    int begin = max(0, task.expected_start - max_err);
+    int end = min((int) task.genome->size(),
+                  task.expected_start + task.read.size() + max_err);
+    if (!myers_.Align(task.read, *task.genome, begin, end, task.expected_start,
+                      max_err, starts[i], dists[i])) {
+      dists[i] = max_err + 1;
+    }
+  }
+
+  int width = lanes();
+  for (size_t i = 0; i < batch.size(); i += width) {
+    int num_tasks = min((int) (batch.size() - i), width);
+    AlignBatch(&batch[i], num_tasks, max_err);
+    for (int t = 0; t < num_tasks; t++) {
+      int id = batch_ids[i + t];
+      dists[id] = batch_dists_[t];
+      // Overhangs are aligned against positions outside of genome, which
+      // costs the same as insertions at the genome end.
+      starts[id] = min(max(batch_starts_[t], 0), (int) batch[i + t].genome->size());
+    }
+  }
+}
+
+void BatchedAligner::AlignBatch(const BandedTask* tasks, int num_tasks, int max_err) {
+  int width = lanes();
+  int band = 2 * max_err + 1;
+  int max_length = 0;
+  for (int t = 0; t < num_tasks; t++) {
+    max_length = max(max_length, tasks[t].read.size());
+  }
+
+  // Genome positions outside of genome and unused lanes get 0, which
+  // matches nothing.
+  int genome_rows = max_length + band;
+  read_bases_.assign((size_t) max_length * width, 0);
+  genome_bases_.assign((size_t) genome_rows * width, 0);
+  lengths_.assign(width, 0);
+  for (int t = 0; t < num_tasks; t++) {
+    const PackedRead& read = tasks[t].read;
+    const string& genome = *tasks[t].genome;
+    int window_start = tasks[t].expected_start - max_err;
+    lengths_[t] = read.size();
+    for (int i = 0; i < read.size(); i++) {
+      read_bases_[i * width + t] = read[i];
+    }
+    int from = max(0, -window_start);
+    int to = min(genome_rows, (int) genome.size() - window_start);
+    for (int j = from; j < to; j++) {
+      genome_bases_[j * width + t] = genome[window_start + j];
+    }
+  }
+
+  values_.resize((size_t) band * width);
+  window_starts_.resize((size_t) band * width);
+  switch (level_) {
+#if defined(__x86_64__) || defined(__i386__)
+    case SIMD_AVX2:
+      BandedAlignLanesAvx2(read_bases_.data(), genome_bases_.data(), lengths_.data(),
+                           max_length, max_err, values_.data(), window_starts_.data());
+      break;
+    case SIMD_SSE41:
+      BandedAlignLanesSse41(read_bases_.data(), genome_bases_.data(), lengths_.data(),
+                            max_length, max_err, values_.data(), window_starts_.data());
+      break;
+#endif
+    default:
+      BandedAlignLanesScalar(read_bases_.data(), genome_bases_.data(), lengths_.data(),
+                             max_length, max_err, values_.data(), window_starts_.data());
+  }
+
+  batch_dists_.resize(num_tasks);
+  batch_starts_.resize(num_tasks);
+  for (int t = 0; t < num_tasks; t++) {
+    // End closest to the expected one (diagonal max_err) from the best ends
+    int best_d = 0;
+    for (int d = 1; d < band; d++) {
+      int value = values_[d * width + t];
+      int best_value = values_[best_d * width + t];
+      if (value < best_value ||
+          (value == best_value && abs(d - max_err) < abs(best_d - max_err))) {
+        best_d = d;
+      }
+    }
+    batch_dists_[t] = values_[best_d * width + t];
+    batch_starts_[t] = tasks[t].expected_start - max_err +
+                       window_starts_[best_d * width + t];
+  }
+}
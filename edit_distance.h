@@ -0,0 +1,153 @@
+#ifndef EDIT_DISTANCE_H__
+#define EDIT_DISTANCE_H__
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "packed_read_store.h"
+
+using namespace std;
+
+// Bit-parallel semi-global edit distance (Myers 1999), patterns longer than
+// 64 bases are split into blocks of 64 rows (Hyyro 2003). Keeps its buffers
+// between calls, so use one instance per thread.
+class MyersAligner {
+ public:
+  MyersAligner() : blocks_(0), length_(0) {}
+
+  // Finds alignment of the whole read to some substring of genome[begin, end)
+  // with the fewest edits. From equally good alignments the one whose end and
+  // then start are closest to expected_start + read length and
+  // expected_start is chosen. Returns false if best alignment has more than
+  // max_err edits.
+  bool Align(const string& read, const string& genome, int begin, int end,
+             int expected_start, int max_err, int& start, int& dist) {
+    return AlignRead(read, genome, begin, end, expected_start, max_err, start, dist);
+  }
+
+  bool Align(const PackedRead& read, const string& genome, int begin, int end,
+             int expected_start, int max_err, int& start, int& dist) {
+    return AlignRead(read, genome, begin, end, expected_start, max_err, start, dist);
+  }
+
+ private:
+  template<class TRead>
+  bool AlignRead(const TRead& read, const string& genome, int begin, int end,
+                 int expected_start, int max_err, int& start, int& dist) {
+    if (read.empty() || begin >= end) return false;
+    PreparePattern(read, false);
+    int best_end;
+    if (!FindEnd(genome, begin, end, expected_start + (int) read.size(), max_err,
+                 best_end, dist)) {
+      return false;
+    }
+    PreparePattern(read, true);
+    return FindStart(genome, begin, best_end, expected_start, dist, start);
+  }
+
+  // Builds match bitmasks of (possibly reversed) read
+  template<class TRead>
+  void PreparePattern(const TRead& read, bool reversed) {
+    length_ = read.size();
+    blocks_ = (length_ + 63) / 64;
+    for (int c = 0; c < 4; c++) {
+      peq_[c].assign(blocks_, 0);
+    }
+    for (int i = 0; i < length_; i++) {
+      int bits = BaseToBits(read[reversed ? length_ - 1 - i : i]);
+      if (bits >= 0) {
+        peq_[bits][i / 64] |= 1ULL << (i % 64);
+      }
+    }
+  }
+
+  // Scans genome[begin, end) with prepared pattern, finds best distance and
+  // end closest to expected_end with it.
+  bool FindEnd(const string& genome, int begin, int end, int expected_end,
+               int max_err, int& best_end, int& dist);
+
+  // Scans genome backwards from best_end with reversed pattern and finds
+  // start with distance dist closest to expected_start.
+  bool FindStart(const string& genome, int begin, int best_end,
+                 int expected_start, int dist, int& start);
+
+  // Runs over genome[from], genome[from + step], ... until reaching to and
+  // stores in scores_ the best distance of pattern ending at each position.
+  void Scan(const string& genome, int from, int to, int step);
+
+  // peq_[base][block] has bit i set if pattern[block * 64 + i] == base
+  vector<uint64_t> peq_[4];
+  vector<uint64_t> pv_;
+  vector<uint64_t> mv_;
+  vector<int> scores_;
+  int blocks_;
+  int length_;
+};
+
+// Read and its seeded genome window for BatchedAligner
+struct BandedTask {
+  BandedTask() {}
+  BandedTask(const PackedRead& read_, const string* genome_, int expected_start_) :
+      read(read_), genome(genome_), expected_start(expected_start_) {}
+  PackedRead read;
+  const string* genome;
+  // Genome position of read start if there were no indels
+  int expected_start;
+};
+
+enum SimdLevel {
+  SIMD_NONE,
+  SIMD_SSE41,
+  SIMD_AVX2
+};
+
+// Semi-global edit distance of many reads at once, each against its own
+// genome window, one read per SIMD lane (16 lanes with SSE4.1, 32 with
+// AVX2). Alignment starts at most max_err from expected_start and stays in
+// band of 2 * max_err + 1 diagonals, which does not lose any alignment with
+// at most max_err edits. Keeps its buffers between calls, so use one
+// instance per thread.
+class BatchedAligner {
+ public:
+  // Uses the best instruction set supported by the CPU
+  BatchedAligner();
+  // level must be supported by the CPU
+  explicit BatchedAligner(SimdLevel level);
+
+  static SimdLevel SupportedLevel();
+
+  SimdLevel level() const {
+    return level_;
+  }
+
+  // Reads verified at once
+  int lanes() const;
+
+  // Fills dists[i] and starts[i] for tasks[i]. dists[i] > max_err means
+  // that read does not align. From equally good alignments the one with end
+  // closest to expected is chosen. Reads longer than kMaxLength are aligned
+  // by MyersAligner.
+  void Align(const vector<BandedTask>& tasks, int max_err,
+             vector<int>& dists, vector<int>& starts);
+
+  // Limits of 8-bit lanes
+  static const int kMaxErrors = 15;
+  static const int kMaxLength = 254;
+
+ private:
+  // Aligns tasks[0, num_tasks) in lanes, results go to batch_dists_ and
+  // batch_starts_.
+  void AlignBatch(const BandedTask* tasks, int num_tasks, int max_err);
+
+  SimdLevel level_;
+  vector<uint8_t> read_bases_;
+  vector<uint8_t> genome_bases_;
+  vector<uint8_t> lengths_;
+  vector<uint8_t> values_;
+  vector<uint8_t> window_starts_;
+  vector<int> batch_dists_;
+  vector<int> batch_starts_;
+  MyersAligner myers_;
+};
+
+#endif
@@ -0,0 +1,32 @@
+// Compiled with -mavx2, called only when CPU supports it.
+#if defined(__x86_64__) || defined(__i386__)
+
+#include "banded_kernel.h"
+#include "edit_distance.h"
+#include <immintrin.h>
+
+namespace {
+
+struct Avx2Vec {
+  typedef __m256i V;
+  static const int kLanes = 32;
+  static V Load(const uint8_t* p) { return _mm256_loadu_si256((const __m256i*) p); }
+  static void Store(uint8_t* p, V a) { _mm256_storeu_si256((__m256i*) p, a); }
+  static V Set1(int x) { return _mm256_set1_epi8((char) x); }
+  static V AddSat(V a, V b) { return _mm256_adds_epu8(a, b); }
+  static V Min(V a, V b) { return _mm256_min_epu8(a, b); }
+  static V Eq(V a, V b) { return _mm256_cmpeq_epi8(a, b); }
+  static V AndNot(V a, V b) { return _mm256_andnot_si256(a, b); }
+  static V Blend(V a, V b, V mask) { return _mm256_blendv_epi8(a, b, mask); }
+};
+
+} // namespace
+
+void BandedAlignLanesAvx2(const uint8_t* read_bases, const uint8_t* genome_bases,
+                          const uint8_t* lengths, int max_length, int max_err,
+                          uint8_t* values, uint8_t* starts) {
+  BandedAlignLanes<Avx2Vec, BatchedAligner::kMaxErrors * 2 + 1>(
+      read_bases, genome_bases, lengths, max_length, max_err, values, starts);
+}
+
+#endif
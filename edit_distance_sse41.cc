@@ -0,0 +1,32 @@
+// Compiled with -msse4.1, called only when CPU supports it.
+#if defined(__x86_64__) || defined(__i386__)
+
+#include "banded_kernel.h"
+#include "edit_distance.h"
+#include <smmintrin.h>
+
+namespace {
+
+struct Sse41Vec {
+  typedef __m128i V;
+  static const int kLanes = 16;
+  static V Load(const uint8_t* p) { return _mm_loadu_si128((const __m128i*) p); }
+  static void Store(uint8_t* p, V a) { _mm_storeu_si128((__m128i*) p, a); }
+  static V Set1(int x) { return _mm_set1_epi8((char) x); }
+  static V AddSat(V a, V b) { return _mm_adds_epu8(a, b); }
+  static V Min(V a, V b) { return _mm_min_epu8(a, b); }
+  static V Eq(V a, V b) { return _mm_cmpeq_epi8(a, b); }
+  static V AndNot(V a, V b) { return _mm_andnot_si128(a, b); }
+  static V Blend(V a, V b, V mask) { return _mm_blendv_epi8(a, b, mask); }
+};
+
+} // namespace
+
+void BandedAlignLanesSse41(const uint8_t* read_bases, const uint8_t* genome_bases,
+                           const uint8_t* lengths, int max_length, int max_err,
+                           uint8_t* values, uint8_t* starts) {
+  BandedAlignLanes<Sse41Vec, BatchedAligner::kMaxErrors * 2 + 1>(
+      read_bases, genome_bases, lengths, max_length, max_err, values, starts);
+}
+
+#endif
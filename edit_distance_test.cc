@@ -0,0 +1,155 @@
+#include "edit_distance.h"
+#include <gtest/gtest.h>
+
+TEST(MyersAlignerTest, ExactTest) {
+  MyersAligner aligner;
+  string genome = "GGGAAAACCCCTTTTGGGGTTT";
+  int start, dist;
+  ASSERT_TRUE(aligner.Align("AAAACCCCTTTTGGGG", genome, 0, genome.size(), 3, 6,
+                            start, dist));
+  EXPECT_EQ(3, start);
+  EXPECT_EQ(0, dist);
+}
+
+TEST(MyersAlignerTest, EditsTest) {
+  MyersAligner aligner;
+  int start, dist;
+  // substitution
+  string genome = "GGGAAAACCCCTATTGGGGTTT";
+  ASSERT_TRUE(aligner.Align("AAAACCCCTTTTGGGG", genome, 0, genome.size(), 3, 6,
+                            start, dist));
+  EXPECT_EQ(3, start);
+  EXPECT_EQ(1, dist);
+  // deletion from genome
+  genome = "GGGAAAACCCTTTTGGGGTTT";
+  ASSERT_TRUE(aligner.Align("AAAACCCCTTTTGGGG", genome, 0, genome.size(), 3, 6,
+                            start, dist));
+  EXPECT_EQ(3, start);
+  EXPECT_EQ(1, dist);
+  // insertion to genome
+  genome = "GGGAAAACCCCATTTTGGGGTTT";
+  ASSERT_TRUE(aligner.Align("AAAACCCCTTTTGGGG", genome, 0, genome.size(), 3, 6,
+                            start, dist));
+  EXPECT_EQ(3, start);
+  EXPECT_EQ(1, dist);
+  // too many errors
+  EXPECT_FALSE(aligner.Align("AAAACCCCTTTTGGGG", genome, 0, genome.size(), 3, 0,
+                             start, dist));
+}
+
+TEST(MyersAlignerTest, OverhangTest) {
+  MyersAligner aligner;
+  int start, dist;
+  string genome = "CCCCTTTTGGGG";
+  ASSERT_TRUE(aligner.Align("AAAACCCCTTTTGGGG", genome, 0, genome.size(), -4, 6,
+                            start, dist));
+  EXPECT_EQ(0, start);
+  EXPECT_EQ(4, dist);
+}
+
+TEST(MyersAlignerTest, LongReadTest) {
+  srand(47);
+  char alph[] = "ACGT";
+  string read;
+  for (int i = 0; i < 250; i++) {
+    read += alph[rand()%4];
+  }
+  string genome = "ACGTAC" + read.substr(0, 100) + read.substr(101, 99) + "T" +
+      read.substr(200) + "GGTACA";
+  MyersAligner aligner;
+  int start, dist;
+  ASSERT_TRUE(aligner.Align(read, genome, 0, genome.size(), 6, 6, start, dist));
+  EXPECT_EQ(6, start);
+  EXPECT_EQ(2, dist);
+}
+
+TEST(BatchedAlignerTest, EditsTest) {
+  BatchedAligner aligner;
+  PackedReadStore reads;
+  reads.Add("AAAACCCCTTTTGGGG");
+  vector<string> genomes = {
+    "GGGAAAACCCCTTTTGGGGTTT",   // exact
+    "GGGAAAACCCCTATTGGGGTTT",   // substitution
+    "GGGAAAACCCTTTTGGGGTTT",    // deletion from genome
+    "GGGAAAACCCCATTTTGGGGTTT",  // insertion to genome
+    "CCCCTTTTGGGG"              // overhang
+  };
+  vector<BandedTask> tasks;
+  for (size_t i = 0; i < genomes.size(); i++) {
+    tasks.push_back(BandedTask(reads[0], &genomes[i], i == 4 ? -4 : 3));
+  }
+  vector<int> dists, starts;
+  aligner.Align(tasks, 6, dists, starts);
+  EXPECT_EQ(vector<int>({0, 1, 1, 1, 4}), dists);
+  EXPECT_EQ(vector<int>({3, 3, 3, 3, 0}), starts);
+}
+
+TEST(BatchedAlignerTest, MatchesMyersTest) {
+  srand(47);
+  char alph[] = "ACGT";
+  string genome;
+  for (int i = 0; i < 2000; i++) {
+    genome += alph[rand()%4];
+  }
+  // Reads with random edits and different lengths, some longer than lanes
+  // can hold
+  PackedReadStore reads;
+  vector<int> positions;
+  for (int i = 0; i < 100; i++) {
+    int length = i % 10 == 0 ? 300 : 50 + rand() % 100;
+    int pos = rand() % (genome.size() - length);
+    string read = genome.substr(pos, length);
+    int edits = rand() % 9;
+    for (int e = 0; e < edits; e++) {
+      int p = rand() % read.size();
+      switch (rand() % 3) {
+        case 0: read[p] = alph[rand()%4]; break;
+        case 1: read.erase(p, 1); break;
+        default: read.insert(p, 1, alph[rand()%4]);
+      }
+    }
+    // Some reads have N
+    if (i % 7 == 0) read[read.size() / 2] = 'N';
+    reads.Add(read);
+    positions.push_back(pos);
+  }
+  vector<BandedTask> tasks;
+  for (size_t i = 0; i < reads.size(); i++) {
+    tasks.push_back(BandedTask(reads[i], &genome, positions[i]));
+  }
+
+  const int max_err = 6;
+  MyersAligner myers;
+  vector<int> expected_dists;
+  for (auto& task: tasks) {
+    int begin = max(0, task.expected_start - max_err);
+    int end = min((int) genome.size(),
+                  task.expected_start + task.read.size() + max_err);
+    int start, dist;
+    if (!myers.Align(task.read, genome, begin, end, task.expected_start,
+                     max_err, start, dist)) {
+      dist = max_err + 1;
+    }
+    expected_dists.push_back(dist);
+  }
+
+  vector<SimdLevel> levels = {SIMD_NONE};
+  if (BatchedAligner::SupportedLevel() >= SIMD_SSE41) levels.push_back(SIMD_SSE41);
+  if (BatchedAligner::SupportedLevel() >= SIMD_AVX2) levels.push_back(SIMD_AVX2);
+  vector<int> scalar_starts;
+  for (auto level: levels) {
+    BatchedAligner aligner(level);
+    vector<int> dists, starts;
+    aligner.Align(tasks, max_err, dists, starts);
+    for (size_t i = 0; i < tasks.size(); i++) {
+      EXPECT_EQ(min(expected_dists[i], max_err + 1), min(dists[i], max_err + 1))
+          << "level " << level << " task " << i;
+    }
+    // All instruction sets give identical results
+    if (level == SIMD_NONE) {
+      scalar_starts = starts;
+    } else {
+      EXPECT_EQ(scalar_starts, starts);
+    }
+  }
+}
@@ -0,0 +1,112 @@
+#include "extension_index.h"
+#include <algorithm>
+#include <cassert>
+
+ExtensionIndex::ExtensionIndex(const vector<Node*>& starts, int big_node_threshold,
+                               int step_threshold, int distance_threshold,
+                               size_t max_states, size_t max_start_states) :
+    big_node_threshold_(big_node_threshold),
+    step_threshold_(step_threshold),
+    distance_threshold_(distance_threshold),
+    max_states_(max_states),
+    max_start_states_(max_start_states),
+    num_skipped_starts_(0),
+    size_limit_(0),
+    overflow_(false) {
+  for (auto &n: starts) {
+    AddStart(n);
+    if (n->rc_ != NULL) {
+      AddStart(n->rc_);
+    }
+  }
+}
+
+const size_t ExtensionIndex::kDefaultMaxStates;
+const size_t ExtensionIndex::kDefaultMaxStartStates;
+
+void ExtensionIndex::AddStart(const Node* start) {
+  size_limit_ = min(max_states_, probabilities_.size() + max_start_states_);
+  overflow_ = false;
+  Compute(State{start, 0, 0});
+  if (overflow_) {
+    num_skipped_starts_++;
+  }
+}
+
+double ExtensionIndex::Compute(const State& s) {
+  auto it = probabilities_.find(s);
+  if (it != probabilities_.end()) {
+    return it->second;
+  }
+  if (overflow_ || probabilities_.size() >= size_limit_) {
+    overflow_ = true;
+    return 0;
+  }
+  // Steps strictly increase, so the recursion is at most step_threshold_
+  // deep
+  double sum = 0;
+  for (auto &next: s.node->next_) {
+    if (next->IsBig(big_node_threshold_)) {
+      sum += 1;
+      continue;
+    }
+    State ns{next, s.steps + 1, s.distance + (int) next->str_.size()};
+    if (ns.steps <= step_threshold_ && ns.distance <= distance_threshold_) {
+      sum += Compute(ns);
+    }
+  }
+  // Sum misses states which did not fit, s would be wrong
+  if (overflow_ || probabilities_.size() >= size_limit_) {
+    overflow_ = true;
+    return 0;
+  }
+  double p = s.node->next_.empty() ? 0 : sum / s.node->next_.size();
+  probabilities_[s] = p;
+  return p;
+}
+
+double ExtensionIndex::StepProbability(const State& s, const Node* next) const {
+  if (next->IsBig(big_node_threshold_)) {
+    return 1;
+  }
+  State ns{next, s.steps + 1, s.distance + (int) next->str_.size()};
+  if (ns.steps > step_threshold_ || ns.distance > distance_threshold_) {
+    return 0;
+  }
+  auto it = probabilities_.find(ns);
+  assert(it != probabilities_.end());
+  return it->second;
+}
+
+double ExtensionIndex::SuccessProbability(const Node* start) const {
+  auto it = probabilities_.find(State{start, 0, 0});
+  return it == probabilities_.end() ? -1 : it->second;
+}
+
+bool ExtensionIndex::Extend(Path& p, default_random_engine& generator) const {
+  double start_probability = SuccessProbability(p.nodes_.back());
+  if (start_probability < 0) {
+    return p.ExtendRandomly(big_node_threshold_, step_threshold_, distance_threshold_,
+                            generator);
+  }
+  // Fails as often as ExtendRandomly would
+  if (start_probability == 0 ||
+      uniform_real_distribution<double>()(generator) >= start_probability) {
+    return false;
+  }
+  State s{p.nodes_.back(), 0, 0};
+  vector<double> weights;
+  while (true) {
+    weights.clear();
+    for (auto &next: s.node->next_) {
+      weights.push_back(StepProbability(s, next));
+    }
+    discrete_distribution<int> choice(weights.begin(), weights.end());
+    Node* next = s.node->next_[choice(generator)];
+    p.AppendNode(next);
+    if (next->IsBig(big_node_threshold_)) {
+      return true;
+    }
+    s = State{next, s.steps + 1, s.distance + (int) next->str_.size()};
+  }
+}
@@ -0,0 +1,102 @@
+#ifndef EXTENSION_INDEX_H__
+#define EXTENSION_INDEX_H__
+
+#include "path.h"
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Precomputed outcome of Path::ExtendRandomly from the given start nodes
+// (and their reverse complements), so that extending samples only walks
+// which reach a big node. For every state of the walk (last node, small
+// nodes added, their total length) it stores the probability that the
+// walk succeeds from there. Extend fails with the probability that
+// ExtendRandomly fails from the same start and otherwise samples the next
+// node weighted by these probabilities, so its result is distributed
+// exactly as that of ExtendRandomly. Callers which retry failed moves
+// (MakeMove) therefore weight starts by their success probability as
+// without the index, but a failed attempt costs one lookup instead of a
+// walk, and a successful one the time of the walk.
+//
+// A small node can be reached in up to (step_threshold + 1) *
+// (distance_threshold + 1) states, so in tangled parts of the graph a
+// start may need millions of them. A start which needs more than
+// max_start_states new states, or does not fit into max_states in total
+// (about 50 bytes per state), is not indexed and Extend from it falls
+// back to ExtendRandomly. States it completed are kept for later starts,
+// so building takes time proportional to max_states at most.
+//
+// Immutable after construction, may be shared between threads.
+class ExtensionIndex {
+ public:
+  static const size_t kDefaultMaxStates = 1 << 22;
+  static const size_t kDefaultMaxStartStates = 1 << 16;
+
+  ExtensionIndex(const vector<Node*>& starts, int big_node_threshold,
+                 int step_threshold, int distance_threshold,
+                 size_t max_states = kDefaultMaxStates,
+                 size_t max_start_states = kDefaultMaxStartStates);
+
+  // Probability that ExtendRandomly from start succeeds, -1 if start
+  // was not indexed
+  double SuccessProbability(const Node* start) const;
+
+  // Same as p.ExtendRandomly with thresholds of the index: returns false
+  // (and leaves p unchanged) with the probability that the walk fails,
+  // otherwise appends a successful walk. Falls back to ExtendRandomly if p
+  // does not end with an indexed node.
+  bool Extend(Path& p, default_random_engine& generator) const;
+
+  // Number of indexed walk states
+  size_t size() const {
+    return probabilities_.size();
+  }
+
+  // Number of start nodes (counting reverse complements separately) not
+  // indexed because they needed too many states
+  int num_skipped_starts() const {
+    return num_skipped_starts_;
+  }
+
+ private:
+  struct State {
+    const Node* node;
+    int steps;
+    int distance;
+
+    bool operator==(const State& s) const {
+      return node == s.node && steps == s.steps && distance == s.distance;
+    }
+  };
+
+  struct StateHash {
+    size_t operator()(const State& s) const {
+      size_t h = hash<const void*>()(s.node);
+      h = h * 1000003 + s.steps;
+      return h * 1000003 + s.distance;
+    }
+  };
+
+  // Probability that the walk succeeds after stepping from s to next, 0
+  // if the step exceeds thresholds. Only for states already indexed.
+  double StepProbability(const State& s, const Node* next) const;
+  void AddStart(const Node* start);
+  // Stores only states with all successors stored, so once the table
+  // reaches size_limit_ it sets overflow_ and returns without storing
+  double Compute(const State& s);
+
+  int big_node_threshold_;
+  int step_threshold_;
+  int distance_threshold_;
+  size_t max_states_;
+  size_t max_start_states_;
+  int num_skipped_starts_;
+  // Table size limit for the current start and whether it was hit
+  size_t size_limit_;
+  bool overflow_;
+  unordered_map<State, double, StateHash> probabilities_;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "extension_index.h"
+#include "graph.h"
+#include "moves.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+// Resident memory in megabytes
+long ResidentMegabytes() {
+  ifstream statm("/proc/self/statm");
+  long size = 0, resident = 0;
+  statm >> size >> resident;
+  return resident * sysconf(_SC_PAGESIZE) / (1 << 20);
+}
+
+// Builds extension index with default thresholds of MoveConfig and
+// reports its build time and memory. Uses LastGraph file if given,
+// otherwise synthetic graph where about big_percent of nodes are big and
+// small nodes are 1 to 30 bases long, as tips and bubbles of Velvet.
+// Usage: extension_index_benchmark [LastGraph|-] [num_nodes] [big_percent]
+//     [max_states] [max_start_states]
+int main(int argc, char** argv) {
+  string filename = argc > 1 ? argv[1] : "-";
+  int num_nodes = argc > 2 ? atoi(argv[2]) : 200000;
+  int big_percent = argc > 3 ? atoi(argv[3]) : 30;
+  size_t max_states = argc > 4 ? atoll(argv[4]) : ExtensionIndex::kDefaultMaxStates;
+  size_t max_start_states = argc > 5 ? atoll(argv[5]) : ExtensionIndex::kDefaultMaxStartStates;
+  const int threshold = 500;
+
+  Graph* g;
+  if (filename != "-") {
+    g = LoadGraph(filename);
+    if (g == NULL) {
+      printf("Cannot load graph %s\n", filename.c_str());
+      return 1;
+    }
+  } else {
+    srand(47);
+    stringstream text;
+    text << num_nodes << "\t" << num_nodes << "\t31\t1\n";
+    for (int i = 1; i <= num_nodes; i++) {
+      int length = rand() % 100 < big_percent ? threshold : 1 + rand() % 30;
+      text << "NODE\t" << i << "\t" << length << "\t0\t0\t0\t0\n";
+      text << string(length, 'A') << "\n" << string(length, 'T') << "\n";
+    }
+    for (int i = 0; i < 2 * num_nodes; i++) {
+      int a = 1 + rand() % num_nodes;
+      int b = 1 + rand() % num_nodes;
+      text << "ARC\t" << (rand()%2 ? a : -a) << "\t" << (rand()%2 ? b : -b) << "\t1\n";
+    }
+    string data = text.str();
+    g = LoadGraph(data.data(), data.size());
+  }
+  vector<Node*> starts = g->GetBigNodes(threshold);
+  printf("Graph with %d nodes, %d big\n", (int) g->nodes_.size(), (int) starts.size());
+
+  long resident_before = ResidentMegabytes();
+  auto start = chrono::steady_clock::now();
+  MoveConfig config;
+  ExtensionIndex index(starts, threshold, config.rand_extend_step_threshold,
+                       config.rand_extend_distance_threshold, max_states,
+                       max_start_states);
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  int indexed = 0;
+  for (auto &n: starts) {
+    if (index.SuccessProbability(n) >= 0) indexed++;
+  }
+  printf("Extension index: %zu states, %d of %d starts indexed (%d orientations skipped), "
+         "%.3f s, +%ld MB\n", index.size(), indexed, (int) starts.size(),
+         index.num_skipped_starts(), seconds, ResidentMegabytes() - resident_before);
+}
@@ -0,0 +1,112 @@
+#include "extension_index.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+Node* MakeNode(int id, const string& str) {
+  Node* n = new Node(str, id, NULL);
+  return n;
+}
+
+}  // namespace
+
+TEST(ExtensionIndexTest, SuccessProbabilityTest) {
+  Node* a = MakeNode(1, "AAAAA");
+  Node* b = MakeNode(2, "TTT");
+  Node* c = MakeNode(3, "CCCCC");
+  Node* d = MakeNode(4, "G");
+  a->AddNext(b);
+  a->AddNext(d);
+  b->AddNext(c);
+
+  ExtensionIndex index({a, c}, 5, 3, 3);
+  EXPECT_DOUBLE_EQ(0.5, index.SuccessProbability(a));
+  EXPECT_DOUBLE_EQ(0, index.SuccessProbability(c));
+  EXPECT_DOUBLE_EQ(-1, index.SuccessProbability(b));
+
+  ExtensionIndex short_index({a}, 5, 3, 2);
+  EXPECT_DOUBLE_EQ(0, short_index.SuccessProbability(a));
+  ExtensionIndex few_steps_index({a}, 5, 0, 3);
+  EXPECT_DOUBLE_EQ(0, few_steps_index.SuccessProbability(a));
+}
+
+TEST(ExtensionIndexTest, MaxStatesTest) {
+  Node* a = MakeNode(1, "AAAAA");
+  Node* b = MakeNode(2, "TTT");
+  Node* c = MakeNode(3, "CCCCC");
+  Node* d = MakeNode(4, "G");
+  a->AddNext(b);
+  a->AddNext(d);
+  b->AddNext(c);
+
+  ExtensionIndex full_index({a, c}, 5, 3, 3);
+  EXPECT_EQ(0, full_index.num_skipped_starts());
+  EXPECT_EQ(4, full_index.size());
+
+  // States of a, b and d fit, c does not
+  ExtensionIndex index({a, c}, 5, 3, 3, 3);
+  EXPECT_EQ(1, index.num_skipped_starts());
+  EXPECT_EQ(3, index.size());
+  EXPECT_DOUBLE_EQ(0.5, index.SuccessProbability(a));
+  EXPECT_DOUBLE_EQ(-1, index.SuccessProbability(c));
+
+  // a needs three states, so it is skipped (states of b and d are kept),
+  // c still fits
+  ExtensionIndex start_index({a, c}, 5, 3, 3, 10, 2);
+  EXPECT_EQ(1, start_index.num_skipped_starts());
+  EXPECT_EQ(3, start_index.size());
+  EXPECT_DOUBLE_EQ(-1, start_index.SuccessProbability(a));
+  EXPECT_DOUBLE_EQ(0, start_index.SuccessProbability(c));
+
+  // Not indexed, extends randomly, so some walks fail
+  default_random_engine generator(47);
+  int failed = 0;
+  for (int i = 0; i < 100; i++) {
+    Path p({a});
+    if (!start_index.Extend(p, generator)) failed++;
+  }
+  EXPECT_LT(0, failed);
+  EXPECT_GT(100, failed);
+}
+
+TEST(ExtensionIndexTest, ExtendTest) {
+  Node* a = MakeNode(1, "AAAAA");
+  Node* b = MakeNode(2, "TTT");
+  Node* c = MakeNode(3, "CCCCC");
+  Node* d = MakeNode(4, "G");
+  a->AddNext(b);
+  a->AddNext(d);
+  a->AddNext(c);
+  b->AddNext(c);
+
+  ExtensionIndex index({a, c}, 5, 3, 3);
+  EXPECT_DOUBLE_EQ(2.0 / 3, index.SuccessProbability(a));
+  default_random_engine generator(47);
+  int succeeded = 0, direct = 0;
+  for (int i = 0; i < 3000; i++) {
+    Path p({a});
+    if (!index.Extend(p, generator)) {
+      EXPECT_EQ(1, p.size());
+      continue;
+    }
+    succeeded++;
+    EXPECT_EQ(c, p.back());
+    EXPECT_EQ(p.ToString().size(), p.Length());
+    if (p.size() == 2) direct++;
+  }
+  // Fails as often as ExtendRandomly (via d), both successful walks are
+  // equally likely
+  EXPECT_LT(1900, succeeded);
+  EXPECT_GT(2100, succeeded);
+  EXPECT_LT(0.45 * succeeded, direct);
+  EXPECT_GT(0.55 * succeeded, direct);
+
+  Path p({c});
+  EXPECT_FALSE(index.Extend(p, generator));
+  EXPECT_EQ(1, p.size());
+
+  // Not indexed, same as ExtendRandomly
+  Path p2({b});
+  EXPECT_TRUE(index.Extend(p2, generator));
+  EXPECT_EQ(vector<Node*>({b, c}), p2.nodes_);
+}
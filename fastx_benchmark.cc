@@ -0,0 +1,67 @@
+#include "fastx_reader.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+// Writes synthetic FASTQ file of given size (gzipped if name ends with .gz)
+// and measures how fast FastxReader and line by line reading parse it.
+// Usage: fastx_benchmark [filename] [size_mb] [read_length]
+int main(int argc, char** argv) {
+  string filename = argc > 1 ? argv[1] : "/tmp/fastx_benchmark.fastq";
+  long long size_mb = argc > 2 ? atoll(argv[2]) : 2048;
+  int read_length = argc > 3 ? atoi(argv[3]) : 150;
+  bool gzipped = filename.size() > 3 && filename.substr(filename.size() - 3) == ".gz";
+
+  srand(47);
+  char alph[] = "ACGT";
+  gzFile gz = gzopen(filename.c_str(), gzipped ? "wb1" : "wbT");
+  if (gz == NULL) {
+    printf("Cannot write %s\n", filename.c_str());
+    return 1;
+  }
+  string record;
+  long long written = 0, num_reads = 0;
+  while (written < size_mb << 20) {
+    record = "@read" + to_string(num_reads) + "\n";
+    for (int i = 0; i < read_length; i++) {
+      record += alph[rand()%4];
+    }
+    record += "\n+\n" + string(read_length, 'I') + "\n";
+    gzwrite(gz, record.data(), record.size());
+    written += record.size();
+    num_reads++;
+  }
+  gzclose(gz);
+  printf("Wrote %lld reads, %lld MB\n", num_reads, written >> 20);
+
+  auto start = chrono::steady_clock::now();
+  FastxReader reader(filename);
+  FastxRecord rec;
+  long long count = 0, bases = 0;
+  while (reader.Next(rec)) {
+    count++;
+    bases += rec.seq_length;
+  }
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  printf("FastxReader: %lld reads, %lld bases, %.3f s, %.1f MB/s\n",
+         count, bases, seconds, written / seconds / (1 << 20));
+
+  if (!gzipped) {
+    start = chrono::steady_clock::now();
+    ifstream is(filename);
+    string l1, l2, l3, l4;
+    count = bases = 0;
+    while (getline(is, l1)) {
+      getline(is, l2);
+      getline(is, l3);
+      getline(is, l4);
+      count++;
+      bases += l2.size();
+    }
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("getline: %lld reads, %lld bases, %.3f s, %.1f MB/s\n",
+           count, bases, seconds, written / seconds / (1 << 20));
+  }
+  remove(filename.c_str());
+}
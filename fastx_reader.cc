@@ -0,0 +1,154 @@
+#include "fastx_reader.h"
+#include <cerrno>
+#include <cstring>
+
+FastxReader::FastxReader(istream& is) :
+    is_(&is), gz_(NULL), good_(true), eof_(false), buffer_(kBufferSize),
+    record_start_(0), pos_(0), end_(0) {}
+
+FastxReader::FastxReader(const string& filename) :
+    is_(NULL), good_(true), eof_(false), buffer_(kBufferSize),
+    record_start_(0), pos_(0), end_(0) {
+  // zlib reads uncompressed files as they are
+  gz_ = gzopen(filename.c_str(), "rb");
+  if (gz_ == NULL) {
+    SetError("cannot open " + filename + ": " + strerror(errno));
+    return;
+  }
+  gzbuffer(gz_, 1 << 20);
+}
+
+FastxReader::~FastxReader() {
+  if (gz_ != NULL) {
+    gzclose(gz_);
+  }
+}
+
+bool FastxReader::Fill() {
+  if (eof_) return false;
+  // Keep only the current record at the start of buffer, grow buffer if
+  // even that does not leave space.
+  if (record_start_ > 0) {
+    memmove(&buffer_[0], &buffer_[record_start_], end_ - record_start_);
+    pos_ -= record_start_;
+    end_ -= record_start_;
+    record_start_ = 0;
+  }
+  if (end_ == buffer_.size()) {
+    buffer_.resize(buffer_.size() * 2);
+  }
+
+  size_t want = buffer_.size() - end_;
+  size_t got;
+  if (gz_ != NULL) {
+    int ret = gzread(gz_, &buffer_[end_], want);
+    // Truncated gzip data end with 0 and an error, damaged data with -1
+    int errnum = Z_OK;
+    const char* message = ret <= 0 ? gzerror(gz_, &errnum) : NULL;
+    if (ret < 0 || (errnum != Z_OK && errnum != Z_STREAM_END)) {
+      SetError(message);
+      return false;
+    }
+    got = ret;
+  } else {
+    is_->read(&buffer_[end_], want);
+    got = is_->gcount();
+  }
+  if (got == 0) {
+    eof_ = true;
+    return false;
+  }
+  end_ += got;
+  return true;
+}
+
+void FastxReader::SetError(const string& error) {
+  good_ = false;
+  error_ = error;
+  eof_ = true;
+}
+
+bool FastxReader::ReadLine(size_t& begin, size_t& end) {
+  size_t scanned = pos_;
+  const char* newline;
+  while ((newline = (const char*) memchr(&buffer_[0] + scanned, '\n', end_ - scanned)) == NULL) {
+    scanned = end_;
+    size_t old_start = record_start_;
+    if (!Fill()) {
+      // Last line without newline
+      if (pos_ == end_) return false;
+      begin = pos_ - record_start_;
+      end = end_ - record_start_;
+      pos_ = end_;
+      if (end > begin && buffer_[record_start_ + end - 1] == '\r') end--;
+      return true;
+    }
+    scanned -= old_start - record_start_;
+  }
+  size_t line_end = newline - &buffer_[0];
+  begin = pos_ - record_start_;
+  end = line_end - record_start_;
+  if (end > begin && buffer_[line_end - 1] == '\r') end--;
+  pos_ = line_end + 1;
+  return true;
+}
+
+int FastxReader::Peek() {
+  if (pos_ == end_ && !Fill()) return -1;
+  return buffer_[pos_];
+}
+
+bool FastxReader::Next(FastxRecord& record) {
+  // Skip empty lines between records
+  record_start_ = pos_;
+  int c;
+  while ((c = Peek()) == '\n' || c == '\r') {
+    pos_++;
+  }
+  if (c == -1) return false;
+  record_start_ = pos_;
+
+  size_t name_begin, name_end;
+  if (!ReadLine(name_begin, name_end)) return false;
+  size_t seq_begin = name_end, seq_end = name_end;
+  bool joined = false;
+  if (c == '@') {
+    size_t plus_begin, plus_end, qual_begin, qual_end;
+    ReadLine(seq_begin, seq_end);
+    ReadLine(plus_begin, plus_end);
+    ReadLine(qual_begin, qual_end);
+  } else {
+    // FASTA sequence ends before the next header and can span many lines
+    int lines = 0;
+    while ((c = Peek()) != -1 && c != '>') {
+      size_t begin, end;
+      ReadLine(begin, end);
+      if (lines == 0) {
+        seq_begin = begin;
+        seq_end = end;
+      } else {
+        if (lines == 1) {
+          joined_.assign(&buffer_[record_start_ + seq_begin], seq_end - seq_begin);
+          joined = true;
+        }
+        joined_.append(&buffer_[record_start_ + begin], end - begin);
+      }
+      lines++;
+    }
+  }
+
+  // Record cut by a read error is not returned
+  if (!good_) return false;
+
+  if (joined) {
+    record.seq = joined_.data();
+    record.seq_length = joined_.size();
+  } else {
+    record.seq = &buffer_[record_start_ + seq_begin];
+    record.seq_length = seq_end - seq_begin;
+  }
+  // Name without the leading '@' or '>'
+  record.name = &buffer_[record_start_ + name_begin + 1];
+  record.name_length = name_end > name_begin ? name_end - name_begin - 1 : 0;
+  return true;
+}
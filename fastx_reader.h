@@ -0,0 +1,85 @@
+#ifndef FASTX_READER_H__
+#define FASTX_READER_H__
+
+#include <istream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+using namespace std;
+
+// One record of FastxReader, pointers are valid until the next call of
+// FastxReader::Next.
+struct FastxRecord {
+  const char* name;
+  int name_length;
+  const char* seq;
+  int seq_length;
+
+  string Name() const {
+    return string(name, name_length);
+  }
+
+  string Seq() const {
+    return string(seq, seq_length);
+  }
+};
+
+// Buffered reader of FASTQ and FASTA (also with sequence split into many
+// lines) files. Format is detected from the first record. Records are
+// parsed in place in a large buffer, so reading does not allocate memory
+// per record.
+class FastxReader {
+ public:
+  // Reads stream, which must stay open while reader is used
+  explicit FastxReader(istream& is);
+  // Reads file, which can be compressed by gzip
+  explicit FastxReader(const string& filename);
+  ~FastxReader();
+
+  // False if file could not be opened or reading it failed (e.g. damaged
+  // gzip data), then Next returns false and error() says why
+  bool good() const {
+    return good_;
+  }
+
+  const string& error() const {
+    return error_;
+  }
+
+  // Returns false at the end of input
+  bool Next(FastxRecord& record);
+
+  static const size_t kBufferSize = 4 << 20;
+
+ private:
+  FastxReader(const FastxReader&);
+  FastxReader& operator=(const FastxReader&);
+
+  // Appends more input after end_, returns false at the end of input or
+  // on error. Data before record_start_ are discarded.
+  bool Fill();
+
+  void SetError(const string& error);
+
+  // Reads line starting at pos_ and stores its position relative to
+  // record_start_, line ends are not included.
+  bool ReadLine(size_t& begin, size_t& end);
+
+  // Character at pos_ or -1 at the end of input
+  int Peek();
+
+  istream* is_;
+  gzFile gz_;
+  bool good_;
+  string error_;
+  bool eof_;
+  vector<char> buffer_;
+  size_t record_start_;
+  size_t pos_;
+  size_t end_;
+  // Sequence of FASTA record joined from many lines
+  string joined_;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "fastx_reader.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <unistd.h>
+
+TEST(FastxReaderTest, FastqTest) {
+  stringstream ss;
+  ss << "@r1 desc" << endl << "ACGT" << endl << "+" << endl << "IIII" << endl;
+  ss << "@r2\r\nGGA\r\n+r2\r\nIII\r\n";
+  ss << "@r3" << endl << "TT" << endl << "+" << endl << "II";
+  FastxReader reader(ss);
+  FastxRecord record;
+  ASSERT_TRUE(reader.Next(record));
+  EXPECT_EQ("r1 desc", record.Name());
+  EXPECT_EQ("ACGT", record.Seq());
+  ASSERT_TRUE(reader.Next(record));
+  EXPECT_EQ("r2", record.Name());
+  EXPECT_EQ("GGA", record.Seq());
+  ASSERT_TRUE(reader.Next(record));
+  EXPECT_EQ("r3", record.Name());
+  EXPECT_EQ("TT", record.Seq());
+  EXPECT_FALSE(reader.Next(record));
+}
+
+TEST(FastxReaderTest, MultiLineFastaTest) {
+  stringstream ss;
+  ss << ">a" << endl << "ACGT" << endl << "GG" << endl << "T" << endl;
+  ss << ">b" << endl << "CCC" << endl << endl;
+  ss << ">empty" << endl;
+  ss << ">c" << endl << "A" << endl;
+  FastxReader reader(ss);
+  FastxRecord record;
+  ASSERT_TRUE(reader.Next(record));
+  EXPECT_EQ("a", record.Name());
+  EXPECT_EQ("ACGTGGT", record.Seq());
+  ASSERT_TRUE(reader.Next(record));
+  EXPECT_EQ("b", record.Name());
+  EXPECT_EQ("CCC", record.Seq());
+  ASSERT_TRUE(reader.Next(record));
+  EXPECT_EQ("empty", record.Name());
+  EXPECT_EQ("", record.Seq());
+  ASSERT_TRUE(reader.Next(record));
+  EXPECT_EQ("c", record.Name());
+  EXPECT_EQ("A", record.Seq());
+  EXPECT_FALSE(reader.Next(record));
+}
+
+TEST(FastxReaderTest, LargeInputTest) {
+  // Records cross buffer boundaries and one is longer than the buffer.
+  stringstream ss;
+  int num_reads = 2 * FastxReader::kBufferSize / 40;
+  for (int i = 0; i < num_reads; i++) {
+    ss << "@r" << i << endl << string(10 + i % 7, "ACGT"[i % 4]) << endl
+       << "+" << endl << string(10 + i % 7, 'I') << endl;
+  }
+  string long_seq(FastxReader::kBufferSize + 100, 'C');
+  ss << "@long" << endl << long_seq << endl << "+" << endl << long_seq << endl;
+
+  FastxReader reader(ss);
+  FastxRecord record;
+  for (int i = 0; i < num_reads; i++) {
+    ASSERT_TRUE(reader.Next(record));
+    ASSERT_EQ("r" + to_string(i), record.Name());
+    ASSERT_EQ(string(10 + i % 7, "ACGT"[i % 4]), record.Seq());
+  }
+  ASSERT_TRUE(reader.Next(record));
+  EXPECT_EQ(long_seq, record.Seq());
+  EXPECT_FALSE(reader.Next(record));
+}
+
+TEST(FastxReaderTest, GzipTest) {
+  char filename[] = "/tmp/fastx_reader_testXXXXXX";
+  int fd = mkstemp(filename);
+  ASSERT_NE(-1, fd);
+  close(fd);
+  gzFile gz = gzopen(filename, "wb");
+  string data = "@r1\nACGT\n+\nIIII\n@r2\nTTGA\n+\nIIII\n";
+  gzwrite(gz, data.data(), data.size());
+  gzclose(gz);
+
+  FastxReader reader{string(filename)};
+  ASSERT_TRUE(reader.good());
+  FastxRecord record;
+  ASSERT_TRUE(reader.Next(record));
+  EXPECT_EQ("ACGT", record.Seq());
+  ASSERT_TRUE(reader.Next(record));
+  EXPECT_EQ("TTGA", record.Seq());
+  EXPECT_FALSE(reader.Next(record));
+  remove(filename);
+
+  FastxReader missing{string(filename)};
+  EXPECT_FALSE(missing.good());
+  EXPECT_FALSE(missing.Next(record));
+  EXPECT_NE(string::npos, missing.error().find(filename));
+}
+
+TEST(FastxReaderTest, DamagedGzipTest) {
+  string data;
+  for (int i = 0; i < 3000; i++) {
+    data += "@r" + to_string(i) + "\nACGTACGTAC\n+\nIIIIIIIIII\n";
+  }
+  for (int damage = 0; damage < 2; damage++) {
+    char filename[] = "/tmp/fastx_reader_testXXXXXX";
+    int fd = mkstemp(filename);
+    ASSERT_NE(-1, fd);
+    close(fd);
+    gzFile gz = gzopen(filename, "wb");
+    gzwrite(gz, data.data(), data.size());
+    gzclose(gz);
+    ifstream is(filename, ios::binary);
+    string compressed((istreambuf_iterator<char>(is)), istreambuf_iterator<char>());
+    is.close();
+    if (damage == 0) {
+      // Truncated
+      compressed.resize(compressed.size() / 2);
+    } else {
+      // Damaged, found by checksum at the end
+      compressed[compressed.size() / 2] ^= 0xff;
+      compressed[compressed.size() / 2 + 1] ^= 0xff;
+    }
+    ofstream of(filename, ios::binary);
+    of.write(compressed.data(), compressed.size());
+    of.close();
+
+    FastxReader reader{string(filename)};
+    ASSERT_TRUE(reader.good());
+    FastxRecord record;
+    int records = 0;
+    while (reader.Next(record)) {
+      EXPECT_EQ("ACGTACGTAC", record.Seq());
+      records++;
+    }
+    EXPECT_GT(3000, records);
+    EXPECT_FALSE(reader.good());
+    EXPECT_FALSE(reader.error().empty());
+    remove(filename);
+  }
+}
@@ -3,55 +3,203 @@
 #include "read_set.h"
 #include "read_probability_calculator.h"
 #include "moves.h"
+#include "extension_index.h"
+#include "path_set.h"
+#include "thread_pool.h"
 #include "config.pb.h"
 #include <google/protobuf/text_format.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <cmath>
 #include <random>
 
+// State of one annealing chain
+struct Chain {
+  Chain(const GlobalProbabilityCalculator& calculator_, const PathSet& paths_,
+        double prob_, double temperature_scale_, int seed) :
+      calculator(calculator_), paths(paths_), prob(prob_),
+      temperature_scale(temperature_scale_), generator(seed) {}
+
+  GlobalProbabilityCalculator calculator;
+  PathSet paths;
+  double prob;
+  double temperature_scale;
+  default_random_engine generator;
+};
+
+double GetTemperature(const Config& gaml_config, int it_num) {
+  return gaml_config.t0() / log(it_num / gaml_config.n_divisor() + 1);
+}
+
+// Metropolis rule at temperature T
+bool AcceptMove(double old_prob, double new_prob, bool accept_high_prob, double T,
+                default_random_engine& generator, bool verbose) {
+  if (new_prob > old_prob) {
+    return true;
+  }
+  if (accept_high_prob) {
+    double prob = exp((new_prob - old_prob) / T);
+    uniform_real_distribution<double> dist(0.0, 1.0);
+    double samp = dist(generator);
+    if (samp < prob) {
+      if (verbose) cout << " higher";
+      return true;
+    }
+  }
+  return false;
+}
+
+// Proposes one move and accepts it by Metropolis rule at temperature T
+void AnnealingStep(Chain& chain, const MoveConfig& move_config, double T, bool verbose) {
+  PathSet new_paths;
+  bool accept_high_prob;
+  MakeMove(chain.paths, new_paths, move_config, accept_high_prob, chain.generator);
+  ProbabilityChanges prob_changes;
+  double new_prob = chain.calculator.GetPathsProbability(new_paths, prob_changes);
+  if (verbose) cout << new_prob;
+
+  if (AcceptMove(chain.prob, new_prob, accept_high_prob, T, chain.generator, verbose)) {
+    if (verbose) cout << " accept";
+    chain.prob = new_prob;
+    chain.paths = new_paths;
+    chain.calculator.ApplyProbabilityChanges(prob_changes);
+  }
+  if (verbose) cout << endl << PathsToDebugString(new_paths) << endl << endl;
+}
+
+// Proposes num_proposals moves from the current state, scores them
+// concurrently and accepts the first one (in proposal order) which passes
+// the Metropolis rule. Rejected moves do not change the state, so this is
+// the same chain as proposing them one per iteration; proposals after the
+// accepted one are dropped. Returns the number of iterations used.
+int SpeculativeStep(Chain& chain, const MoveConfig& move_config, const Config& gaml_config,
+                    int it_num, int num_proposals, ThreadPool* pool) {
+  vector<PathSet> new_paths(num_proposals);
+  vector<bool> accept_high_prob(num_proposals);
+  for (int i = 0; i < num_proposals; i++) {
+    bool high;
+    MakeMove(chain.paths, new_paths[i], move_config, high, chain.generator);
+    accept_high_prob[i] = high;
+  }
+  vector<ProbabilityChanges> prob_changes(num_proposals);
+  vector<double> new_probs(num_proposals);
+  ParallelFor(pool, num_proposals, [&](int i) {
+    new_probs[i] = chain.calculator.GetPathsProbability(new_paths[i], prob_changes[i]);
+  });
+
+  for (int i = 0; i < num_proposals; i++) {
+    double T = GetTemperature(gaml_config, it_num + i);
+    cout << "Iter: " << it_num + i << " T: " << T << endl;
+    cout << new_probs[i];
+    bool accept = AcceptMove(chain.prob, new_probs[i], accept_high_prob[i], T,
+                             chain.generator, true);
+    if (accept) {
+      cout << " accept";
+      chain.prob = new_probs[i];
+      chain.paths = new_paths[i];
+      chain.calculator.ApplyProbabilityChanges(prob_changes[i]);
+    }
+    cout << endl << PathsToDebugString(new_paths[i]) << endl << endl;
+    if (accept) return i + 1;
+  }
+  return num_proposals;
+}
+
 void PerformOptimization(GlobalProbabilityCalculator& probability_calculator,
-                         const Config& gaml_config, vector<Path>& paths) {
-  default_random_engine generator(47);
+                         const Config& gaml_config, const MoveConfig& move_config,
+                         PathSet& paths) {
   ProbabilityChanges prob_changes;
   double old_prob = probability_calculator.GetPathsProbability(paths, prob_changes);
   cout << "starting probability: " << old_prob << endl;
   probability_calculator.ApplyProbabilityChanges(prob_changes);
 
   cout << PathsToDebugString(paths) << endl;
-  MoveConfig move_config;
-  for (int it_num = 1; it_num <= gaml_config.num_iterations(); it_num++) {
-    double T = gaml_config.t0() / log(it_num / gaml_config.n_divisor() + 1);
-    cout << "Iter: " << it_num << " T: " << T << endl;
-
-    vector<Path> new_paths;
-    bool accept_high_prob;
-    MakeMove(paths, new_paths, move_config, accept_high_prob);
-    double new_prob = probability_calculator.GetPathsProbability(new_paths, prob_changes);
-    cout << new_prob;
-
-    bool accept = false;
-    if (new_prob > old_prob) {
-      accept = true;
-    } else if (accept_high_prob) {
-      double prob = exp((new_prob - old_prob) / T);
-      uniform_real_distribution<double> dist(0.0, 1.0);
-      double samp = dist(generator);
-      if (samp < prob) {
-        cout << " higher";
-        accept = true;
+  Chain chain(probability_calculator, paths, old_prob, 1, 47);
+  int num_proposals = max(1, gaml_config.speculative_proposals());
+  if (num_proposals > 1) {
+    ThreadPool proposal_pool(num_proposals);
+    int it_num = 1;
+    while (it_num <= gaml_config.num_iterations()) {
+      it_num += SpeculativeStep(
+          chain, move_config, gaml_config, it_num,
+          min(num_proposals, gaml_config.num_iterations() - it_num + 1), &proposal_pool);
+    }
+  } else {
+    for (int it_num = 1; it_num <= gaml_config.num_iterations(); it_num++) {
+      double T = GetTemperature(gaml_config, it_num);
+      cout << "Iter: " << it_num << " T: " << T << endl;
+      AnnealingStep(chain, move_config, T, true);
+    }
+  }
+  paths = chain.paths;
+
+  ofstream of(gaml_config.output_file());
+  PathsToFasta(paths, of);
+}
+
+// Runs num_chains chains at increasing temperatures, each on its own thread
+// with its own random generator and probability state (read sets and
+// alignment caches are shared). Neighbouring chains swap their states
+// every swap_interval iterations with the usual replica exchange
+// acceptance, so good states found by hot chains move to the cold ones.
+// Writes the best state seen in any chain.
+void PerformParallelTempering(GlobalProbabilityCalculator& probability_calculator,
+                              const Config& gaml_config, const MoveConfig& move_config,
+                              PathSet& paths) {
+  ProbabilityChanges prob_changes;
+  double start_prob = probability_calculator.GetPathsProbability(paths, prob_changes);
+  cout << "starting probability: " << start_prob << endl;
+  probability_calculator.ApplyProbabilityChanges(prob_changes);
+
+  int num_chains = gaml_config.num_chains();
+  vector<Chain> chains;
+  for (int i = 0; i < num_chains; i++) {
+    double scale = i < gaml_config.temperature_ladder_size() ?
+        gaml_config.temperature_ladder(i) : pow(2.0, i);
+    chains.push_back(Chain(probability_calculator, paths, start_prob, scale, 47 + i));
+  }
+  ThreadPool chain_pool(num_chains);
+  default_random_engine swap_generator(47);
+  uniform_real_distribution<double> dist(0.0, 1.0);
+  PathSet best_paths = paths;
+  double best_prob = start_prob;
+  int swap_interval = max(1, gaml_config.swap_interval());
+
+  for (int it_num = 1; it_num <= gaml_config.num_iterations(); it_num += swap_interval) {
+    int steps = min(swap_interval, gaml_config.num_iterations() - it_num + 1);
+    chain_pool.ParallelFor(num_chains, [&](int c) {
+      for (int s = 0; s < steps; s++) {
+        double T = GetTemperature(gaml_config, it_num + s) * chains[c].temperature_scale;
+        AnnealingStep(chains[c], move_config, T, false);
+      }
+    });
+
+    double T = GetTemperature(gaml_config, it_num + steps - 1);
+    for (int c = 0; c + 1 < num_chains; c++) {
+      double cold = 1 / (T * chains[c].temperature_scale);
+      double hot = 1 / (T * chains[c+1].temperature_scale);
+      double log_ratio = (chains[c+1].prob - chains[c].prob) * (cold - hot);
+      if (log_ratio >= 0 || dist(swap_generator) < exp(log_ratio)) {
+        swap(chains[c].calculator, chains[c+1].calculator);
+        swap(chains[c].paths, chains[c+1].paths);
+        swap(chains[c].prob, chains[c+1].prob);
       }
     }
 
-    if (accept) {
-      cout << " accept";
-      old_prob = new_prob;
-      paths = new_paths;
-      probability_calculator.ApplyProbabilityChanges(prob_changes);
+    cout << "Iter: " << it_num + steps - 1 << " T: " << T << " probabilities:";
+    for (auto &chain: chains) {
+      cout << " " << chain.prob;
+      if (chain.prob > best_prob) {
+        best_prob = chain.prob;
+        best_paths = chain.paths;
+      }
     }
-    cout << endl << PathsToDebugString(new_paths) << endl << endl;
+    cout << endl << PathsToDebugString(chains[0].paths) << endl << endl;
   }
+  paths = best_paths;
+  cout << "best probability: " << best_prob << endl;
 
   ofstream of(gaml_config.output_file());
   PathsToFasta(paths, of);
@@ -73,9 +221,29 @@ int main(int argc, char** argv) {
 
   int threshold = 500;
 
-  vector<Path> paths = BuildPathsFromSingleNodes(g->GetBigNodes(threshold));
+  PathSet paths = BuildPathsFromSingleNodes(g->GetBigNodes(threshold));
 
   cout << PathsToDebugString(paths) << endl;
 
-  PerformOptimization(probability_calculator, gaml_config, paths);
+  MoveConfig move_config;
+  move_config.big_node_threshold = threshold;
+  unique_ptr<ExtensionIndex> extension_index;
+  if (gaml_config.extension_index()) {
+    extension_index.reset(new ExtensionIndex(g->GetBigNodes(threshold),
+                                             move_config.big_node_threshold,
+                                             move_config.rand_extend_step_threshold,
+                                             move_config.rand_extend_distance_threshold));
+    cout << "Extension index has " << extension_index->size() << " states" << endl;
+    if (extension_index->num_skipped_starts() > 0) {
+      cout << extension_index->num_skipped_starts()
+           << " nodes need too many states, they extend randomly" << endl;
+    }
+    move_config.extension_index = extension_index.get();
+  }
+
+  if (gaml_config.num_chains() > 1) {
+    PerformParallelTempering(probability_calculator, gaml_config, move_config, paths);
+  } else {
+    PerformOptimization(probability_calculator, gaml_config, move_config, paths);
+  }
 }
@@ -1,7 +1,13 @@
 #include "graph.h"
+#include "graph_snapshot.h"
 #include <boost/algorithm/string.hpp>
-#include <queue>
-#include <unordered_set>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using boost::is_any_of;
 using boost::split;
@@ -30,38 +36,169 @@ pair<int, int> LoadArc(istream& is) {
                    VelvetNumToMyNum(stoi(arc_tokens[2])));
 }
 
+namespace {
+
+// Walks over lines of in-memory text
+class LineReader {
+ public:
+  LineReader(const char* data, size_t size) : pos_(data), end_(data + size) {}
+
+  // Line without the newline
+  bool Next(const char*& line, int& length) {
+    if (pos_ >= end_) return false;
+    line = pos_;
+    const char* newline = (const char*) memchr(pos_, '\n', end_ - pos_);
+    if (newline == NULL) newline = end_;
+    length = newline - pos_;
+    pos_ = newline + 1;
+    return true;
+  }
+
+ private:
+  const char* pos_;
+  const char* end_;
+};
+
+// Parses integer at p (which is moved past it), 0 if there is none
+int ParseInt(const char*& p, const char* end) {
+  bool negative = false;
+  if (p < end && *p == '-') {
+    negative = true;
+    p++;
+  }
+  int ret = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    ret = ret * 10 + (*p - '0');
+    p++;
+  }
+  return negative ? -ret : ret;
+}
+
+// Moves p past the next tab, returns false if there is none
+bool SkipField(const char*& p, const char* end) {
+  const char* tab = (const char*) memchr(p, '\t', end - p);
+  if (tab == NULL) return false;
+  p = tab + 1;
+  return true;
+}
+
+// Calls f(a, b) for every valid ARC line (in our numbering)
+template<class F>
+void ForEachArc(LineReader& lines, int num_nodes, F f) {
+  const char* line;
+  int length;
+  while (lines.Next(line, length)) {
+    if (length < 3 || memcmp(line, "ARC", 3) != 0) continue;
+    const char* p = line;
+    const char* end = line + length;
+    if (!SkipField(p, end)) continue;
+    int a = VelvetNumToMyNum(ParseInt(p, end));
+    if (!SkipField(p, end)) continue;
+    int b = VelvetNumToMyNum(ParseInt(p, end));
+    if (a < 0 || a >= num_nodes || b < 0 || b >= num_nodes) continue;
+    f(a, b);
+  }
+}
+
+}  // namespace
+
 Graph* LoadGraph(const string &filename) {
-  ifstream is(filename);
-  if (!is) return NULL;
-  return LoadGraph(is);
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return NULL;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return NULL;
+  }
+  void* mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) return NULL;
+  if (IsGraphSnapshot(mapped, st.st_size)) {
+    // Bases are read from the mapping later, at random
+    Graph* g = LoadGraphSnapshot(mapped, st.st_size);
+    if (g == NULL) {
+      munmap(mapped, st.st_size);
+      return NULL;
+    }
+    g->KeepMapping(mapped, st.st_size);
+    return g;
+  }
+  madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+  Graph* g = LoadGraph((const char*) mapped, st.st_size);
+  munmap(mapped, st.st_size);
+  return g;
 }
 
 Graph* LoadGraph(istream &is) {
-  string header;
-  getline(is, header);
-  vector<string> header_parts;
-  split(header_parts, header, is_any_of("\t"));
+  string data((istreambuf_iterator<char>(is)), istreambuf_iterator<char>());
+  return LoadGraph(data.data(), data.size());
+}
+
+Graph* LoadGraph(const char* data, size_t size) {
+  LineReader lines(data, size);
+  const char* line;
+  int length;
+  if (!lines.Next(line, length)) return NULL;
+  const char* p = line;
+  const char* end = line + length;
+  int n_nodes = ParseInt(p, end);
   Graph* g = new Graph();
-  int n_nodes = stoi(header_parts[0]);
-  g->k_ = stoi(header_parts[2]);
+  g->k_ = 0;
+  if (SkipField(p, end) && SkipField(p, end)) {
+    g->k_ = ParseInt(p, end);
+  }
+
+  g->AllocateNodePairs(n_nodes);
   for (int i = 0; i < n_nodes; i++) {
-    Node *a, *b;
-    tie(a, b) = LoadNode(is, i, g);
-    g->nodes_.push_back(a);
-    g->nodes_.push_back(b);
-  }
-
-  while (is) {
-    int a, b;
-    tie(a, b) = LoadArc(is);
-    if (a != -1) {
-      g->nodes_[a]->AddNext(g->nodes_[b]);
-      g->nodes_[b]->rc_->AddNext(g->nodes_[a]->rc_);
-    }
+    // Node header is not needed, nodes are numbered in order
+    lines.Next(line, length);
+    if (lines.Next(line, length)) g->nodes_[2*i]->str_.assign(line, length);
+    if (lines.Next(line, length)) g->nodes_[2*i+1]->str_.assign(line, length);
   }
+
+  // Arcs are read twice, first to size the lists of successors
+  LineReader arc_lines = lines;
+  vector<int> out_degrees(g->nodes_.size());
+  ForEachArc(arc_lines, out_degrees.size(), [&](int a, int b) {
+    out_degrees[a]++;
+    out_degrees[b ^ 1]++;
+  });
+  for (size_t i = 0; i < out_degrees.size(); i++) {
+    g->nodes_[i]->next_.reserve(out_degrees[i]);
+  }
+  ForEachArc(lines, out_degrees.size(), [&](int a, int b) {
+    g->nodes_[a]->AddNext(g->nodes_[b]);
+    g->nodes_[b]->rc_->AddNext(g->nodes_[a]->rc_);
+  });
   return g;
 }
 
+Graph::~Graph() {
+  if (mapping_ != NULL) munmap(mapping_, mapping_size_);
+}
+
+void Graph::KeepMapping(void* mapping, size_t size) {
+  if (mapping_ != NULL) munmap(mapping_, mapping_size_);
+  mapping_ = mapping;
+  mapping_size_ = size;
+}
+
+void Graph::AllocateNodePairs(int n) {
+  // Storage is allocated once, so node pointers stay valid
+  InvalidateCore();
+  node_storage_.clear();
+  nodes_.clear();
+  node_storage_.resize(2 * n);
+  nodes_.reserve(2 * n);
+  for (int i = 0; i < 2 * n; i++) {
+    Node* a = &node_storage_[i];
+    a->id_ = i;
+    a->rc_ = &node_storage_[i ^ 1];
+    a->graph_ = this;
+    nodes_.push_back(a);
+  }
+}
+
 vector<Node*> Graph::GetBigNodes(int threshold) const {
   vector<Node*> ret;
   for (size_t i = 0; i < nodes_.size(); i+= 2) {
@@ -72,66 +209,50 @@ vector<Node*> Graph::GetBigNodes(int threshold) const {
   return ret;
 }
 
-vector<Node*> Graph::ReachForwardWithThreshold(Node* start, int threshold) const {
-  unordered_set<int> visited;
-  queue<Node*> fr;
-  fr.push(start);
-  visited.insert(start->id_);
-  vector<Node*> ret;
-
-  while (!fr.empty()) {
-    Node *x = fr.front();
-    fr.pop();
-    ret.push_back(x);
-    for (auto &nx: x->next_) {
-      if (nx->IsBig(threshold)) {
-        continue;
-      }
-      if (visited.count(nx->id_)) {
-        continue;
-      }
-      visited.insert(nx->id_);
-      fr.push(nx);
-    }
+const GraphCore& Graph::core() const {
+  const GraphCore* core = current_core_.load(memory_order_acquire);
+  if (core != NULL && core->num_nodes() == (int) nodes_.size()) {
+    return *core;
   }
+  lock_guard<mutex> lock(core_mutex_);
+  if (!core_ || core_->num_nodes() != (int) nodes_.size()) {
+    core_.reset(new GraphCore(*this));
+    current_core_.store(core_.get(), memory_order_release);
+  }
+  return *core_;
+}
 
-  return ret;
+void Graph::InvalidateCore() {
+  lock_guard<mutex> lock(core_mutex_);
+  current_core_.store(NULL, memory_order_release);
+  core_.reset();
 }
 
-vector<Node*> Graph::ReachLocalWithThreshold(Node* start, int threshold) const {
-  unordered_set<int> visited;
-  queue<Node*> fr;
-  fr.push(start);
-  visited.insert(start->id_);
+namespace {
+
+vector<Node*> Reach(const Graph& g, Node* start, int threshold, bool local) {
   vector<Node*> ret;
+  const GraphCore& core = g.core();
+  int v = core.index(start);
+  if (v < 0) {
+    fprintf(stderr, "Node %d is not in the graph\n", start->id_);
+    return ret;
+  }
+  vector<int> indices = local ? core.ReachLocalWithThreshold(v, threshold) :
+      core.ReachForwardWithThreshold(v, threshold);
+  ret.reserve(indices.size());
+  for (int i: indices) {
+    ret.push_back(g.nodes_[i]);
+  }
+  return ret;
+}
 
-  while (!fr.empty()) {
-    Node *x = fr.front();
-    fr.pop();
-    ret.push_back(x);
-    for (auto &nx: x->next_) {
-      if (nx->IsBig(threshold)) {
-        continue;
-      }
-      if (visited.count(nx->id_)) {
-        continue;
-      }
-      visited.insert(nx->id_);
-      fr.push(nx);
-    }
-    for (auto &nxr: x->rc_->next_) {
-      auto &nx = nxr->rc_;
-      if (nx->IsBig(threshold)) {
-        continue;
-      }
-      if (visited.count(nx->id_)) {
-        continue;
-      }
-      visited.insert(nx->id_);
-      fr.push(nx);
+}  // namespace
 
-    }
-  }
+vector<Node*> Graph::ReachForwardWithThreshold(Node* start, int threshold) const {
+  return Reach(*this, start, threshold, false);
+}
 
-  return ret;
+vector<Node*> Graph::ReachLocalWithThreshold(Node* start, int threshold) const {
+  return Reach(*this, start, threshold, true);
 }
@@ -2,24 +2,64 @@
 #define GRAPH_H__
 
 #include "node.h"
+#include "graph_core.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <tuple>
 
 class Graph {
  public:
-  Graph() {}
+  Graph() : mapping_(NULL), mapping_size_(0), current_core_(NULL) {}
+  ~Graph();
+  // Nodes may live in node_storage_
+  Graph(const Graph&) = delete;
+  Graph& operator=(const Graph&) = delete;
 
   vector<Node*> GetBigNodes(int threshold) const;
 
+  // Creates n pairs of nodes (node 2i and its reverse complement 2i+1) in
+  // node_storage_, with empty sequences and no arcs.
+  void AllocateNodePairs(int n);
+
+  // Traversals run on core(), may be called from several threads. Empty
+  // (and an error is printed) if start is not in nodes_.
   vector<Node*> ReachForwardWithThreshold(Node* start, int threshold) const;
   vector<Node*> ReachLocalWithThreshold(Node* start, int threshold) const;
 
+  // Built on first use (also when first used by several threads at once)
+  // and rebuilt when the number of nodes changed. Call InvalidateCore()
+  // after changing arcs or sequences of nodes already in the graph. The
+  // graph must not change while it is traversed.
+  const GraphCore& core() const;
+  void InvalidateCore();
+
+  // Takes memory mapped by mmap, unmapped with the graph. Node sequences
+  // may point into it (as after loading a snapshot).
+  void KeepMapping(void* mapping, size_t size);
+
   vector<Node*> nodes_;
   int k_;
+  // Nodes loaded by LoadGraph, in one allocation (nodes_ point here)
+  vector<Node> node_storage_;
+
+ private:
+  void* mapping_;
+  size_t mapping_size_;
+  mutable mutex core_mutex_;
+  mutable unique_ptr<GraphCore> core_;
+  // core_ once built, read without the lock
+  mutable atomic<const GraphCore*> current_core_;
 };
 
 int VelvetNumToMyNum(int x);
 pair<int, int> LoadArc(istream &is);
+// Loaders parse the whole LastGraph text in one pass, the file is mapped
+// into memory. Stream input is read into memory whole first, so it needs
+// twice the size of the text at peak; prefer the file name for big graphs.
+// Return NULL if it cannot be read.
 Graph* LoadGraph(const string& filename);
 Graph* LoadGraph(istream &is);
+Graph* LoadGraph(const char* data, size_t size);
 
 #endif
@@ -0,0 +1,121 @@
+#include "graph_core.h"
+#include "graph.h"
+#include <cstdio>
+
+GraphCore::GraphCore(const Graph& g) : dense_ids_(true), nodes_(g.nodes_.begin(), g.nodes_.end()) {
+  int n = nodes_.size();
+  for (int i = 0; i < n && dense_ids_; i++) {
+    dense_ids_ = nodes_[i]->id_ == i;
+  }
+  if (!dense_ids_) {
+    indices_.reserve(n);
+    for (int i = 0; i < n; i++) {
+      indices_.emplace(nodes_[i], i);
+    }
+  }
+
+  lengths_.resize(n);
+  next_offsets_.reserve(n + 1);
+  prev_offsets_.reserve(n + 1);
+  next_offsets_.push_back(0);
+  prev_offsets_.push_back(0);
+  int missing = 0;
+  for (int i = 0; i < n; i++) {
+    const Node* x = nodes_[i];
+    lengths_[i] = x->str_.size();
+    for (auto &nx: x->next_) {
+      int v = index(nx);
+      if (v < 0) {
+        missing++;
+        continue;
+      }
+      next_.push_back(v);
+    }
+    next_offsets_.push_back(next_.size());
+    if (x->rc_ != NULL) {
+      for (auto &nxr: x->rc_->next_) {
+        int v = nxr->rc_ == NULL ? -1 : index(nxr->rc_);
+        if (v >= 0) prev_.push_back(v);
+      }
+    }
+    prev_offsets_.push_back(prev_.size());
+  }
+  if (missing > 0) {
+    fprintf(stderr, "Graph has %d arcs to nodes which are not in it, they are ignored\n",
+            missing);
+  }
+}
+
+int GraphCore::index(const Node* x) const {
+  if (dense_ids_) {
+    int id = x->id_;
+    return id >= 0 && id < num_nodes() && nodes_[id] == x ? id : -1;
+  }
+  auto it = indices_.find(x);
+  return it == indices_.end() ? -1 : it->second;
+}
+
+namespace {
+
+// Visited marks of the current thread, shared by all cores: node v is
+// visited in the current traversal iff visited[v] == epoch. Stamps only
+// grow, so marks left by other cores are never current.
+struct VisitedStamps {
+  VisitedStamps() : epoch(0) {}
+
+  void NewTraversal(int num_nodes) {
+    if (visited.size() < (size_t) num_nodes) {
+      visited.resize(num_nodes, 0);
+    }
+    epoch++;
+    if (epoch == 0) {
+      // Stamps wrapped around
+      visited.assign(visited.size(), 0);
+      epoch = 1;
+    }
+  }
+
+  // Marks v visited, returns false if it was already
+  bool Visit(int v) {
+    if (visited[v] == epoch) return false;
+    visited[v] = epoch;
+    return true;
+  }
+
+  vector<uint32_t> visited;
+  uint32_t epoch;
+};
+
+thread_local VisitedStamps visited_stamps;
+
+}  // namespace
+
+vector<int> GraphCore::Reach(int start, int threshold, bool local) const {
+  VisitedStamps& stamps = visited_stamps;
+  stamps.NewTraversal(num_nodes());
+  // Visited nodes in BFS order, the queue is the part not expanded yet
+  vector<int> ret;
+  ret.push_back(start);
+  stamps.Visit(start);
+  for (size_t head = 0; head < ret.size(); head++) {
+    int x = ret[head];
+    for (const int* it = next_begin(x); it != next_end(x); ++it) {
+      if (lengths_[*it] >= threshold) continue;
+      if (stamps.Visit(*it)) ret.push_back(*it);
+    }
+    if (!local) continue;
+    for (const int* it = prev_begin(x); it != prev_end(x); ++it) {
+      if (lengths_[*it] >= threshold) continue;
+      if (stamps.Visit(*it)) ret.push_back(*it);
+    }
+  }
+  return ret;
+}
+
+vector<int> GraphCore::ReachForwardWithThreshold(int start, int threshold) const {
+  return Reach(start, threshold, false);
+}
+
+vector<int> GraphCore::ReachLocalWithThreshold(int start, int threshold) const {
+  return Reach(start, threshold, true);
+}
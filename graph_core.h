@@ -0,0 +1,76 @@
+#ifndef GRAPH_CORE_H__
+#define GRAPH_CORE_H__
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+class Graph;
+class Node;
+
+// Structure of a Graph in flat arrays for fast traversals: node i is
+// nodes_[i] of the graph, whatever its id, node lengths are in one array
+// and successors and predecessors in compressed sparse rows. Arcs to
+// nodes which are not in nodes_ are left out. Does not follow later
+// changes of the graph (Graph::core() rebuilds it).
+//
+// Traversals mark visited nodes in a per thread array stamped with the
+// traversal number, so they cost nothing per untouched node and one core
+// may be traversed from several threads at once.
+class GraphCore {
+ public:
+  GraphCore() : dense_ids_(true) {}
+  explicit GraphCore(const Graph& g);
+
+  int num_nodes() const {
+    return lengths_.size();
+  }
+
+  // Index of x, -1 if x is not in nodes_ of the graph
+  int index(const Node* x) const;
+
+  int length(int v) const {
+    return lengths_[v];
+  }
+
+  const int* next_begin(int v) const {
+    return next_.data() + next_offsets_[v];
+  }
+
+  const int* next_end(int v) const {
+    return next_.data() + next_offsets_[v+1];
+  }
+
+  // Predecessors, in order of successors of the reverse complement
+  const int* prev_begin(int v) const {
+    return prev_.data() + prev_offsets_[v];
+  }
+
+  const int* prev_end(int v) const {
+    return prev_.data() + prev_offsets_[v+1];
+  }
+
+  // BFS from start over nodes shorter than threshold (start is always
+  // included), following successors only or also predecessors. Same order
+  // as Graph::Reach*WithThreshold.
+  vector<int> ReachForwardWithThreshold(int start, int threshold) const;
+  vector<int> ReachLocalWithThreshold(int start, int threshold) const;
+
+ private:
+  vector<int> Reach(int start, int threshold, bool local) const;
+
+  // Ids are indices (as after LoadGraph), then indices_ stays empty
+  bool dense_ids_;
+  vector<const Node*> nodes_;
+  unordered_map<const Node*, int> indices_;
+  vector<int> lengths_;
+  // Successors of v are next_[next_offsets_[v], next_offsets_[v+1])
+  vector<int> next_offsets_;
+  vector<int> next_;
+  vector<int> prev_offsets_;
+  vector<int> prev_;
+};
+
+#endif
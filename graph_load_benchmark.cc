@@ -0,0 +1,97 @@
+#include "graph.h"
+#include "graph_snapshot.h"
+#include "util.h"
+#include <boost/algorithm/string.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+// Loader with getline and a Node allocation per node, as LoadGraph used
+// to work
+Graph* LoadGraphByLines(const string& filename) {
+  ifstream is(filename);
+  string header;
+  getline(is, header);
+  vector<string> header_parts;
+  boost::split(header_parts, header, boost::is_any_of("\t"));
+  Graph* g = new Graph();
+  int n_nodes = stoi(header_parts[0]);
+  g->k_ = stoi(header_parts[2]);
+  for (int i = 0; i < n_nodes; i++) {
+    Node *a, *b;
+    tie(a, b) = LoadNode(is, i, g);
+    g->nodes_.push_back(a);
+    g->nodes_.push_back(b);
+  }
+  while (is) {
+    int a, b;
+    tie(a, b) = LoadArc(is);
+    if (a != -1) {
+      g->nodes_[a]->AddNext(g->nodes_[b]);
+      g->nodes_[b]->rc_->AddNext(g->nodes_[a]->rc_);
+    }
+  }
+  return g;
+}
+
+// Writes synthetic LastGraph file and measures how fast both loaders
+// parse it and how fast its binary snapshot loads.
+// Usage: graph_load_benchmark [filename] [num_nodes] [mean_node_length]
+int main(int argc, char** argv) {
+  string filename = argc > 1 ? argv[1] : "/tmp/graph_load_benchmark.LastGraph";
+  int num_nodes = argc > 2 ? atoi(argv[2]) : 1000000;
+  int mean_length = argc > 3 ? atoi(argv[3]) : 60;
+
+  srand(47);
+  char alph[] = "ACGT";
+  {
+    ofstream of(filename);
+    of << num_nodes << "\t" << num_nodes << "\t31\t1\n";
+    string sequence;
+    for (int i = 1; i <= num_nodes; i++) {
+      // As in Velvet, both strands come from one sequence of length + k - 1
+      int length = 1 + rand() % (2 * mean_length);
+      sequence.clear();
+      for (int j = 0; j < length + 30; j++) {
+        sequence += alph[rand()%4];
+      }
+      string forward = sequence.substr(30);
+      string backward = ReverseSeq(sequence.substr(0, length));
+      of << "NODE\t" << i << "\t" << length << "\t0\t0\t0\t0\n";
+      of << forward << "\n" << backward << "\n";
+    }
+    for (int i = 0; i < 2 * num_nodes; i++) {
+      int a = 1 + rand() % num_nodes;
+      int b = 1 + rand() % num_nodes;
+      of << "ARC\t" << (rand()%2 ? a : -a) << "\t" << (rand()%2 ? b : -b) << "\t1\n";
+    }
+  }
+  printf("Wrote graph with %d nodes\n", num_nodes);
+
+  auto start = chrono::steady_clock::now();
+  Graph* g = LoadGraph(filename);
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  printf("LoadGraph: %d nodes, %.3f s\n", (int) g->nodes_.size(), seconds);
+
+  start = chrono::steady_clock::now();
+  Graph* g2 = LoadGraphByLines(filename);
+  seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  printf("getline: %d nodes, %.3f s\n", (int) g2->nodes_.size(), seconds);
+
+  string snapshot = filename + ".snapshot";
+  SaveGraphSnapshot(*g, snapshot);
+  start = chrono::steady_clock::now();
+  Graph* g3 = LoadGraph(snapshot);
+  seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  printf("snapshot: %d nodes, %.3f s\n", (int) g3->nodes_.size(), seconds);
+  remove(snapshot.c_str());
+
+  size_t arcs = 0, arcs2 = 0;
+  for (size_t i = 0; i < g->nodes_.size(); i++) {
+    arcs += g->nodes_[i]->next_.size();
+    arcs2 += g2->nodes_[i]->next_.size();
+  }
+  printf("arcs: %zu %zu\n", arcs, arcs2);
+  remove(filename.c_str());
+}
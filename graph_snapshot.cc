@@ -0,0 +1,139 @@
+#include "graph_snapshot.h"
+#include "util.h"
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// Last byte is the format version
+const char kGraphSnapshotMagic[8] = {'G', 'A', 'M', 'L', 'G', 'R', 'F', '2'};
+
+bool WriteArray(FILE* f, const void* data, size_t bytes) {
+  return bytes == 0 || fwrite(data, 1, bytes, f) == bytes;
+}
+
+// Stored bases of a pair: backward is the reverse complement of the odd
+// node. Shared if forward continues backward after the first overlap bases,
+// as in Velvet, where both come from one sequence of length L + k - 1.
+void AddPair(const string& forward, const string& backward, int overlap,
+             string& bases, uint64_t& forward_start, uint64_t& backward_start) {
+  if (forward.size() == backward.size() && (int) forward.size() >= overlap &&
+      backward.compare(overlap, string::npos, forward, 0, forward.size() - overlap) == 0) {
+    backward_start = bases.size();
+    forward_start = bases.size() + overlap;
+    bases += backward;
+    bases.append(forward, forward.size() - overlap, overlap);
+  } else {
+    forward_start = bases.size();
+    bases += forward;
+    backward_start = bases.size();
+    bases += backward;
+  }
+}
+
+}  // namespace
+
+bool SaveGraphSnapshot(const Graph& g, const string& filename) {
+  vector<uint64_t> starts(g.nodes_.size());
+  vector<uint32_t> lengths(g.nodes_.size());
+  string bases;
+  vector<uint64_t> arc_offsets(1, 0);
+  vector<uint32_t> arcs;
+  for (size_t i = 0; i < g.nodes_.size(); i++) {
+    const Node* n = g.nodes_[i];
+    assert(n->id_ == (int) i && n->rc_ == g.nodes_[i ^ 1]);
+    if (n->str_.size() > INT_MAX) return false;
+    lengths[i] = n->str_.size();
+    if (i % 2 == 1) {
+      AddPair(g.nodes_[i-1]->str_.str(), ReverseSeq(n->str_.str()), max(g.k_ - 1, 0),
+              bases, starts[i-1], starts[i]);
+    }
+    for (auto &next: n->next_) {
+      arcs.push_back(next->id_);
+    }
+    arc_offsets.push_back(arcs.size());
+  }
+  bases.resize((bases.size() + 7) / 8 * 8, '\0');
+
+  GraphSnapshotHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kGraphSnapshotMagic, sizeof(header.magic));
+  header.k = g.k_;
+  header.num_nodes = g.nodes_.size();
+  header.num_bases = bases.size();
+  header.num_arcs = arcs.size();
+
+  FILE* f = fopen(filename.c_str(), "wb");
+  if (f == NULL) return false;
+  bool ok = WriteArray(f, &header, sizeof(header)) &&
+      WriteArray(f, starts.data(), starts.size() * sizeof(uint64_t)) &&
+      WriteArray(f, lengths.data(), lengths.size() * sizeof(uint32_t)) &&
+      WriteArray(f, bases.data(), bases.size()) &&
+      WriteArray(f, arc_offsets.data(), arc_offsets.size() * sizeof(uint64_t)) &&
+      WriteArray(f, arcs.data(), arcs.size() * sizeof(uint32_t));
+  if (fclose(f) != 0) ok = false;
+  if (!ok) remove(filename.c_str());
+  return ok;
+}
+
+bool IsGraphSnapshot(const void* data, size_t size) {
+  return size >= sizeof(GraphSnapshotHeader) &&
+      memcmp(data, kGraphSnapshotMagic, sizeof(kGraphSnapshotMagic) - 1) == 0;
+}
+
+Graph* LoadGraphSnapshot(const void* data, size_t size) {
+  if (!IsGraphSnapshot(data, size) ||
+      memcmp(data, kGraphSnapshotMagic, sizeof(kGraphSnapshotMagic)) != 0) {
+    return NULL;
+  }
+  const GraphSnapshotHeader* header = (const GraphSnapshotHeader*) data;
+  uint64_t num_nodes = header->num_nodes;
+  uint64_t num_bases = header->num_bases;
+  if (num_nodes % 2 != 0 || num_bases % 8 != 0) return NULL;
+  // Every count is bounded by size first, so the sum below cannot overflow
+  if (num_nodes >= size / sizeof(uint64_t) || num_nodes > INT_MAX ||
+      num_bases > size || header->num_arcs > size / sizeof(uint32_t)) {
+    return NULL;
+  }
+  size_t expected_size = sizeof(GraphSnapshotHeader) +
+      num_nodes * (sizeof(uint64_t) + sizeof(uint32_t)) + num_bases +
+      (num_nodes + 1) * sizeof(uint64_t) + header->num_arcs * sizeof(uint32_t);
+  if (size != expected_size) return NULL;
+
+  const uint64_t* starts = (const uint64_t*) (header + 1);
+  const uint32_t* lengths = (const uint32_t*) (starts + num_nodes);
+  const char* bases = (const char*) (lengths + num_nodes);
+  const uint64_t* arc_offsets = (const uint64_t*) (bases + num_bases);
+  const uint32_t* arcs = (const uint32_t*) (arc_offsets + num_nodes + 1);
+
+  for (uint64_t i = 0; i < num_nodes; i++) {
+    if (starts[i] > num_bases || lengths[i] > num_bases - starts[i] ||
+        lengths[i] > INT_MAX || arc_offsets[i] > arc_offsets[i+1]) {
+      return NULL;
+    }
+  }
+  if (arc_offsets[0] != 0 || arc_offsets[num_nodes] != header->num_arcs) {
+    return NULL;
+  }
+
+  Graph* g = new Graph();
+  g->k_ = header->k;
+  g->AllocateNodePairs(num_nodes / 2);
+  for (uint64_t i = 0; i < num_nodes; i++) {
+    Node* n = g->nodes_[i];
+    n->str_.SetView(bases + starts[i], lengths[i], i % 2 == 1);
+    n->next_.reserve(arc_offsets[i+1] - arc_offsets[i]);
+    for (uint64_t j = arc_offsets[i]; j < arc_offsets[i+1]; j++) {
+      if (arcs[j] >= num_nodes) {
+        delete g;
+        return NULL;
+      }
+      n->next_.push_back(g->nodes_[arcs[j]]);
+    }
+  }
+  return g;
+}
@@ -0,0 +1,40 @@
+#ifndef GRAPH_SNAPSHOT_H__
+#define GRAPH_SNAPSHOT_H__
+
+#include "graph.h"
+#include <cstddef>
+#include <string>
+
+// Binary form of Graph, meant to be written once by convert_graph and then
+// loaded by LoadGraph (which recognizes it). Bases are not decoded on load:
+// node sequences point into the snapshot, so only the node objects and arcs
+// are built. Node i is reverse complement of node i ^ 1 (as after
+// LoadGraph). Odd nodes point to the reverse complement of their sequence,
+// which for Velvet pairs (backward strand is the forward one shifted by
+// k - 1) overlaps the forward sequence, and then both share the bases.
+// Layout, everything 8 bytes aligned:
+//   GraphSnapshotHeader
+//   uint64_t sequence_starts[num_nodes]   (into bases)
+//   uint32_t sequence_lengths[num_nodes]
+//   char bases[num_bases]                 (zero padded to 8 bytes)
+//   uint64_t arc_offsets[num_nodes + 1]   (CSR of successors)
+//   uint32_t arcs[num_arcs]
+struct GraphSnapshotHeader {
+  char magic[8];
+  uint64_t k;
+  uint64_t num_nodes;
+  uint64_t num_bases;
+  uint64_t num_arcs;
+};
+
+// Returns false if the file cannot be written
+bool SaveGraphSnapshot(const Graph& g, const string& filename);
+
+// Also true for snapshots of other versions, which do not load
+bool IsGraphSnapshot(const void* data, size_t size);
+
+// Returns NULL if data is not a valid snapshot. Node sequences point into
+// data, which must outlive the graph (LoadGraph keeps the file mapped).
+Graph* LoadGraphSnapshot(const void* data, size_t size);
+
+#endif
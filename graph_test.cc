@@ -1,7 +1,27 @@
 #include "graph.h"
+#include "graph_snapshot.h"
 #include <gtest/gtest.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <sstream>
+#include <thread>
 #include <tuple>
+#include <unistd.h>
+
+namespace {
+
+// Creates an empty file with unique name, so concurrent runs do not collide
+string MakeTempFile() {
+  char filename[] = "/tmp/graph_testXXXXXX";
+  int fd = mkstemp(filename);
+  if (fd != -1) close(fd);
+  return filename;
+}
+
+}  // namespace
 
 TEST(GraphTest, VelvetNumToMyNumTest) {
   EXPECT_EQ(0, VelvetNumToMyNum(1));
@@ -70,3 +90,211 @@ TEST(GraphTest, LoadGraphTest) {
   EXPECT_EQ(g, g->nodes_[2]->graph_);
   EXPECT_EQ(g, g->nodes_[3]->graph_);
 }
+
+TEST(GraphTest, LoadGraphFromFileTest) {
+  string filename = MakeTempFile();
+  {
+    ofstream of(filename);
+    of << "2\t1000\t41\t1\n";
+    of << "NODE\t1\t4\t0\t0\n";
+    of << "AAAC\n";
+    of << "TTCC\n";
+    of << "NODE\t2\t4\t0\t0\n";
+    of << "AGAC\n";
+    of << "TGCC\n";
+    of << "ARC\t1\t-2\t44\n";
+    of << "ARC\t-1\t2\t3\n";
+    of << "NR\t1\t1\n";
+    of << "5\t0\t0\n";
+    of << "ARC\t2\t1\t1";
+  }
+  Graph *g = LoadGraph(filename);
+  remove(filename.c_str());
+  ASSERT_NE((Graph*) NULL, g);
+
+  ASSERT_EQ(4, g->nodes_.size());
+  EXPECT_EQ(41, g->k_);
+  EXPECT_EQ("AAAC", g->nodes_[0]->str_);
+  EXPECT_EQ("TGCC", g->nodes_[3]->str_);
+  EXPECT_EQ(g->nodes_[1], g->nodes_[0]->rc_);
+  ASSERT_EQ(1, g->nodes_[0]->next_.size());
+  ASSERT_EQ(g->nodes_[3], g->nodes_[0]->next_[0]);
+  ASSERT_EQ(2, g->nodes_[1]->next_.size());
+  EXPECT_EQ(g->nodes_[2], g->nodes_[1]->next_[0]);
+  EXPECT_EQ(g->nodes_[3], g->nodes_[1]->next_[1]);
+  ASSERT_EQ(2, g->nodes_[2]->next_.size());
+  EXPECT_EQ(g->nodes_[1], g->nodes_[2]->next_[0]);
+  EXPECT_EQ(g->nodes_[0], g->nodes_[2]->next_[1]);
+
+  EXPECT_EQ(NULL, LoadGraph(string("/nonexistent/graph")));
+}
+
+TEST(GraphTest, SnapshotTest) {
+  stringstream ss;
+  ss << "3\t1000\t41\t1\n";
+  ss << "NODE\t1\t4\t0\t0\n";
+  ss << "AANC\n";
+  ss << "TTCC\n";
+  ss << "NODE\t2\t40\t0\t0\n";
+  ss << string(40, 'G') << "\n";
+  ss << string(39, 'C') << "T\n";
+  ss << "NODE\t3\t0\t0\t0\n";
+  ss << "\n";
+  ss << "\n";
+  ss << "ARC\t1\t-2\t44\n";
+  ss << "ARC\t3\t2\t1\n";
+  Graph *g = LoadGraph(ss);
+
+  string filename = MakeTempFile();
+  ASSERT_TRUE(SaveGraphSnapshot(*g, filename));
+  Graph *g2 = LoadGraph(filename);
+  ifstream is(filename, ios::binary);
+  string data((istreambuf_iterator<char>(is)), istreambuf_iterator<char>());
+  remove(filename.c_str());
+  ASSERT_NE((Graph*) NULL, g2);
+
+  EXPECT_EQ(g->k_, g2->k_);
+  ASSERT_EQ(g->nodes_.size(), g2->nodes_.size());
+  for (size_t i = 0; i < g->nodes_.size(); i++) {
+    EXPECT_EQ(g->nodes_[i]->str_, g2->nodes_[i]->str_);
+    EXPECT_EQ((int) i, g2->nodes_[i]->id_);
+    EXPECT_EQ(g2->nodes_[i ^ 1], g2->nodes_[i]->rc_);
+    EXPECT_EQ(g2, g2->nodes_[i]->graph_);
+    ASSERT_EQ(g->nodes_[i]->next_.size(), g2->nodes_[i]->next_.size());
+    for (size_t j = 0; j < g->nodes_[i]->next_.size(); j++) {
+      EXPECT_EQ(g->nodes_[i]->next_[j]->id_, g2->nodes_[i]->next_[j]->id_);
+    }
+  }
+
+  // Node 2 continues the reverse complement of node 3 after k - 1 bases, so
+  // they share bases (4 + 4 for node 0 and 1, 40 + 40 for node 2 and 3)
+  EXPECT_EQ(g2->nodes_[3]->str_.data() + 40, g2->nodes_[2]->str_.data());
+  GraphSnapshotHeader header;
+  ASSERT_LE(sizeof(header), data.size());
+  memcpy(&header, data.data(), sizeof(header));
+  EXPECT_EQ(88, header.num_bases);
+
+  // Counts which do not fit in the data
+  EXPECT_NE((Graph*) NULL, LoadGraphSnapshot(data.data(), data.size()));
+  for (uint64_t count: {(uint64_t) 1 << 62, (uint64_t) 1 << 61, (uint64_t) -2}) {
+    string corrupted = data;
+    header.num_nodes = count;
+    memcpy(&corrupted[0], &header, sizeof(header));
+    EXPECT_EQ(NULL, LoadGraphSnapshot(corrupted.data(), corrupted.size()));
+  }
+  memcpy(&header, data.data(), sizeof(header));
+  header.num_bases = (uint64_t) -8;
+  string corrupted = data;
+  memcpy(&corrupted[0], &header, sizeof(header));
+  EXPECT_EQ(NULL, LoadGraphSnapshot(corrupted.data(), corrupted.size()));
+
+  // Sequence outside of bases
+  corrupted = data;
+  uint64_t start = 85;
+  memcpy(&corrupted[sizeof(header)], &start, sizeof(start));
+  EXPECT_EQ(NULL, LoadGraphSnapshot(corrupted.data(), corrupted.size()));
+
+  // Other version
+  corrupted = data;
+  corrupted[7] = '1';
+  EXPECT_TRUE(IsGraphSnapshot(corrupted.data(), corrupted.size()));
+  EXPECT_EQ(NULL, LoadGraphSnapshot(corrupted.data(), corrupted.size()));
+
+  string text = "not a snapshot";
+  EXPECT_FALSE(IsGraphSnapshot(text.data(), text.size()));
+}
+
+TEST(GraphTest, ReachTest) {
+  stringstream ss;
+  ss << "3\t1000\t41\t1\n";
+  ss << "NODE\t1\t4\t0\t0\n";
+  ss << "AAAC\n";
+  ss << "TTCC\n";
+  ss << "NODE\t2\t40\t0\t0\n";
+  ss << string(40, 'G') << "\n";
+  ss << string(39, 'C') << "T\n";
+  ss << "NODE\t3\t0\t0\t0\n";
+  ss << "\n";
+  ss << "\n";
+  ss << "ARC\t1\t-2\t44\n";
+  ss << "ARC\t3\t2\t1\n";
+  Graph *g = LoadGraph(ss);
+
+  const GraphCore& core = g->core();
+  ASSERT_EQ(6, core.num_nodes());
+  EXPECT_EQ(40, core.length(3));
+  ASSERT_EQ(1, core.prev_end(2) - core.prev_begin(2));
+  EXPECT_EQ(4, *core.prev_begin(2));
+
+  vector<Node*> expected = {g->nodes_[0]};
+  EXPECT_EQ(expected, g->ReachForwardWithThreshold(g->nodes_[0], 10));
+  EXPECT_EQ(expected, g->ReachLocalWithThreshold(g->nodes_[0], 10));
+  expected = {g->nodes_[0], g->nodes_[3], g->nodes_[5]};
+  EXPECT_EQ(expected, g->ReachForwardWithThreshold(g->nodes_[0], 100));
+  expected = {g->nodes_[2], g->nodes_[1], g->nodes_[4]};
+  EXPECT_EQ(expected, g->ReachLocalWithThreshold(g->nodes_[2], 10));
+}
+
+TEST(GraphTest, ReachChangedGraphTest) {
+  // Hand built graph with ids which are not indices
+  Graph g;
+  Node* a = new Node("A", 10, &g);
+  Node* b = new Node("C", 7, &g);
+  Node* c = new Node(string(50, 'G'), 3, &g);
+  a->AddNext(b);
+  b->AddNext(c);
+  g.nodes_ = {a, b, c};
+  EXPECT_EQ(vector<Node*>({a, b}), g.ReachForwardWithThreshold(a, 10));
+  EXPECT_EQ(vector<Node*>({b}), g.ReachLocalWithThreshold(b, 10));
+
+  // Added node is noticed
+  Node* d = new Node("T", 10, &g);
+  b->AddNext(d);
+  g.nodes_.push_back(d);
+  EXPECT_EQ(vector<Node*>({a, b, d}), g.ReachForwardWithThreshold(a, 10));
+
+  // Changed arcs after invalidation
+  b->next_.clear();
+  g.InvalidateCore();
+  EXPECT_EQ(vector<Node*>({a, b}), g.ReachForwardWithThreshold(a, 10));
+
+  // Not in the graph
+  Node* e = new Node("A", 0, &g);
+  EXPECT_TRUE(g.ReachForwardWithThreshold(e, 10).empty());
+}
+
+TEST(GraphTest, ConcurrentReachTest) {
+  // Cycle of small nodes, each traversal visits the whole strand
+  const int kNodes = 200;
+  Graph g;
+  g.k_ = 1;
+  g.AllocateNodePairs(kNodes);
+  for (int i = 0; i < kNodes; i++) {
+    g.nodes_[2*i]->str_ = "A";
+    g.nodes_[2*i+1]->str_ = "T";
+    int next = (i + 1) % kNodes;
+    g.nodes_[2*i]->AddNext(g.nodes_[2*next]);
+    g.nodes_[2*next+1]->AddNext(g.nodes_[2*i+1]);
+  }
+
+  // Threads build the core and traverse it at the same time
+  vector<vector<vector<Node*>>> results(4);
+  vector<thread> threads;
+  for (size_t t = 0; t < results.size(); t++) {
+    threads.push_back(thread([&g, &results, t] {
+      for (int i = 0; i < kNodes; i++) {
+        results[t].push_back(g.ReachLocalWithThreshold(g.nodes_[2*i], 10));
+      }
+    }));
+  }
+  for (auto &t: threads) {
+    t.join();
+  }
+  for (int i = 0; i < kNodes; i++) {
+    vector<Node*> expected = g.ReachLocalWithThreshold(g.nodes_[2*i], 10);
+    ASSERT_EQ(kNodes, expected.size());
+    for (auto &r: results) {
+      EXPECT_EQ(expected, r[i]);
+    }
+  }
+}
@@ -0,0 +1,87 @@
+#include "graph.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+#include <sstream>
+#include <unordered_set>
+
+// Traversal with pointer chasing and hash set of visited nodes, as
+// Graph::ReachLocalWithThreshold used to work
+vector<Node*> ReachLocalByPointers(Node* start, int threshold) {
+  unordered_set<int> visited;
+  queue<Node*> fr;
+  fr.push(start);
+  visited.insert(start->id_);
+  vector<Node*> ret;
+  while (!fr.empty()) {
+    Node *x = fr.front();
+    fr.pop();
+    ret.push_back(x);
+    for (auto &nx: x->next_) {
+      if (nx->IsBig(threshold) || visited.count(nx->id_)) continue;
+      visited.insert(nx->id_);
+      fr.push(nx);
+    }
+    for (auto &nxr: x->rc_->next_) {
+      auto &nx = nxr->rc_;
+      if (nx->IsBig(threshold) || visited.count(nx->id_)) continue;
+      visited.insert(nx->id_);
+      fr.push(nx);
+    }
+  }
+  return ret;
+}
+
+// Builds synthetic graph where about big_percent of nodes are big and
+// measures local traversals from random nodes.
+// Usage: graph_traversal_benchmark [num_nodes] [num_traversals] [big_percent]
+int main(int argc, char** argv) {
+  int num_nodes = argc > 1 ? atoi(argv[1]) : 1000000;
+  int num_traversals = argc > 2 ? atoi(argv[2]) : 100000;
+  int big_percent = argc > 3 ? atoi(argv[3]) : 80;
+  const int threshold = 500;
+
+  srand(47);
+  stringstream text;
+  text << num_nodes << "\t" << num_nodes << "\t31\t1\n";
+  for (int i = 1; i <= num_nodes; i++) {
+    int length = rand() % 100 < big_percent ? threshold : 1 + rand() % 100;
+    text << "NODE\t" << i << "\t" << length << "\t0\t0\t0\t0\n";
+    text << string(length, 'A') << "\n" << string(length, 'T') << "\n";
+  }
+  for (int i = 0; i < 2 * num_nodes; i++) {
+    int a = 1 + rand() % num_nodes;
+    int b = 1 + rand() % num_nodes;
+    text << "ARC\t" << (rand()%2 ? a : -a) << "\t" << (rand()%2 ? b : -b) << "\t1\n";
+  }
+  string data = text.str();
+  Graph* g = LoadGraph(data.data(), data.size());
+  printf("Graph with %d nodes\n", (int) g->nodes_.size());
+
+  vector<Node*> starts;
+  for (int i = 0; i < num_traversals; i++) {
+    starts.push_back(g->nodes_[rand() % g->nodes_.size()]);
+  }
+
+  auto start = chrono::steady_clock::now();
+  g->core();
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  printf("GraphCore build: %.3f s\n", seconds);
+
+  start = chrono::steady_clock::now();
+  long long visited = 0;
+  for (auto &s: starts) {
+    visited += g->ReachLocalWithThreshold(s, threshold).size();
+  }
+  seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  printf("GraphCore: %lld nodes visited, %.3f s\n", visited, seconds);
+
+  start = chrono::steady_clock::now();
+  visited = 0;
+  for (auto &s: starts) {
+    visited += ReachLocalByPointers(s, threshold).size();
+  }
+  seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  printf("pointers: %lld nodes visited, %.3f s\n", visited, seconds);
+}
@@ -24,7 +24,7 @@ namespace std {
   template<typename T> struct hash<vector<T>> {
     inline size_t operator()(const vector<T>& v) const {
       size_t seed = 0;
-      for (int i = 0; i < v.size(); i++) {
+      for (size_t i = 0; i < v.size(); i++) {
         ::hash_combine(seed, v[i]);
       }
       return seed;
@@ -0,0 +1,81 @@
+#ifndef LRU_CACHE_H__
+#define LRU_CACHE_H__
+
+#include <list>
+#include <unordered_map>
+#include "hash_util.h"
+
+using namespace std;
+
+// Map with least-recently-used eviction. Every entry has a cost (usually
+// its approximate size in bytes) and entries are evicted once the total
+// cost exceeds max_cost.
+template<class TKey, class TValue>
+class LruCache {
+ public:
+  LruCache(size_t max_cost = 0) : max_cost_(max_cost), total_cost_(0) {}
+
+  // Returns NULL if key is not present, marks entry as recently used
+  // otherwise. The pointer is valid until the next Put.
+  const TValue* Get(const TKey& key) {
+    auto it = index_.find(key);
+    if (it == index_.end()) return NULL;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return &it->second->value;
+  }
+
+  void Put(const TKey& key, const TValue& value, size_t cost) {
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      total_cost_ -= it->second->cost;
+      entries_.erase(it->second);
+      index_.erase(it);
+    }
+    // Entries bigger than the whole cache are not worth keeping.
+    if (cost > max_cost_) return;
+    entries_.push_front(Entry(key, value, cost));
+    index_[key] = entries_.begin();
+    total_cost_ += cost;
+    while (total_cost_ > max_cost_) {
+      auto& last = entries_.back();
+      total_cost_ -= last.cost;
+      index_.erase(last.key);
+      entries_.pop_back();
+    }
+  }
+
+  void Clear() {
+    entries_.clear();
+    index_.clear();
+    total_cost_ = 0;
+  }
+
+  size_t size() const {
+    return entries_.size();
+  }
+
+  size_t total_cost() const {
+    return total_cost_;
+  }
+
+  size_t max_cost() const {
+    return max_cost_;
+  }
+
+ private:
+  struct Entry {
+    Entry(const TKey& key_, const TValue& value_, size_t cost_) :
+        key(key_), value(value_), cost(cost_) {}
+    TKey key;
+    TValue value;
+    size_t cost;
+  };
+
+  size_t max_cost_;
+  size_t total_cost_;
+  // Most recently used first
+  list<Entry> entries_;
+  unordered_map<TKey, typename list<Entry>::iterator> index_;
+};
+
+#endif
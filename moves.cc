@@ -1,83 +1,109 @@
 #include "moves.h"
+#include "extension_index.h"
+#include "util.h"
 #include <algorithm>
 #include <cassert>
 
-int FindPathWithSameEnding(vector<Path>& paths, int pi) {
-  for (size_t i = 0; i < paths.size(); i++) {
-    auto &p = paths[i];
-    auto rp = p.GetReverse();
-    if (i == pi) continue;
-    if (p[0] == paths[pi].back()) {
-      return i;
-    }
-    if (rp[0] == paths[pi].back()) {
-      paths[i] = rp;
-      return i;
-    }
+// Path other than pi which starts (or its reverse starts, then reverse is
+// set) with the last node of paths[pi], chosen uniformly among such paths.
+// Returns -1 if there is none.
+int FindPathWithSameEnding(const PathSet& paths, int pi, Node* last,
+                           default_random_engine& generator, bool& reverse) {
+  vector<pair<int, bool>> candidates;
+  paths.FindPathsStartingWith(last, candidates);
+  candidates.erase(remove_if(candidates.begin(), candidates.end(),
+                             [pi](const pair<int, bool>& c) { return c.first == pi; }),
+                   candidates.end());
+  if (candidates.empty()) {
+    return -1;
   }
-  return -1;
-}
-
-void MergePaths(vector<Path>& paths, int pi, int same_end) {
-  assert(paths[pi].back() == paths[same_end][0]);
-  paths[pi].AppendPath(paths[same_end], 1);
-  swap(paths[same_end], paths[paths.size()-1]);
-  paths.pop_back();
+  auto &chosen = candidates[RandomInt(generator, candidates.size())];
+  reverse = chosen.second;
+  return chosen.first;
 }
 
-bool ExtendPathsRandomly(const vector<Path>& paths, vector<Path>& out_paths,
-                         const MoveConfig& config) {
-  int pi = rand()%paths.size();
-  out_paths = paths;
-  random_shuffle(out_paths.begin(), out_paths.end());
-  if (rand()%2 == 1) {
-    out_paths[pi].Reverse();
+bool ExtendPathsRandomly(const PathSet& paths, PathSet& out_paths,
+                         const MoveConfig& config, default_random_engine& generator) {
+  int pi = RandomInt(generator, paths.size());
+  Path p = paths[pi];
+  if (RandomInt(generator, 2) == 1) {
+    p.Reverse();
   }
-  if (!out_paths[pi].ExtendRandomly(config.big_node_threshold,
-                                    config.rand_extend_step_threshold,
-                                    config.rand_extend_distance_threshold)) {
+  if (config.extension_index != NULL) {
+    if (!config.extension_index->Extend(p, generator)) {
+      return false;
+    }
+  } else if (!p.ExtendRandomly(config.big_node_threshold,
+                               config.rand_extend_step_threshold,
+                               config.rand_extend_distance_threshold,
+                               generator)) {
     return false;
   }
-  int same_end = FindPathWithSameEnding(out_paths, pi);
+  out_paths = paths;
+  out_paths.StartChanges();
+  bool reverse = false;
+  int same_end = FindPathWithSameEnding(paths, pi, p.back(), generator, reverse);
   if (same_end == -1) {
+    out_paths.Replace(pi, p);
     return true;
   }
 
-  MergePaths(out_paths, pi, same_end);
+  Path other = paths[same_end];
+  if (reverse) {
+    other.Reverse();
+  }
+  assert(p.back() == other[0]);
+  p.AppendPath(other, 1);
+  out_paths.Replace(pi, p);
+  out_paths.Remove(same_end);
   return true;
 }
 
-bool BreakPaths(const vector<Path>& paths, vector<Path>& out_paths,
-                const MoveConfig& config) {
-  int pi = rand()%paths.size();
-  out_paths = paths;
-  if (out_paths[pi].size() < 2) {
+bool BreakPaths(const PathSet& paths, PathSet& out_paths,
+                const MoveConfig& config, default_random_engine& generator) {
+  int pi = RandomInt(generator, paths.size());
+  if (paths[pi].size() < 2) {
     return false;
   }
-  int break_pos = 1+rand()%(out_paths[pi].size()-1);
-  Path p2 = out_paths[pi].CutAt(break_pos, config.big_node_threshold);
-  out_paths.push_back(p2);
+  int break_pos = 1 + RandomInt(generator, paths[pi].size() - 1);
+  Path p1 = paths[pi];
+  Path p2 = p1.CutAt(break_pos, config.big_node_threshold);
+  out_paths = paths;
+  out_paths.StartChanges();
+  out_paths.Replace(pi, p1);
+  out_paths.Add(p2);
   return true;
 }
 
-void MakeMove(const vector<Path>& paths, vector<Path>& out_paths, const MoveConfig& config,
+void MakeMove(const PathSet& paths, PathSet& out_paths, const MoveConfig& config,
               bool& accept_higher_prob) {
+  default_random_engine generator(rand());
+  MakeMove(paths, out_paths, config, accept_higher_prob, generator);
+}
+
+bool TryMove(const PathSet& paths, PathSet& out_paths, const MoveConfig& config,
+             bool& accept_higher_prob) {
+  default_random_engine generator(rand());
+  return TryMove(paths, out_paths, config, accept_higher_prob, generator);
+}
+
+void MakeMove(const PathSet& paths, PathSet& out_paths, const MoveConfig& config,
+              bool& accept_higher_prob, default_random_engine& generator) {
   while (true) {
-    out_paths.clear();
-    if (TryMove(paths, out_paths, config, accept_higher_prob)) return;
+    if (TryMove(paths, out_paths, config, accept_higher_prob, generator)) return;
   }
 }
 
-bool TryMove(const vector<Path>& paths, vector<Path>& out_paths, const MoveConfig& config,
-             bool& accept_higher_prob) {
-  int move = rand()%2;
+bool TryMove(const PathSet& paths, PathSet& out_paths, const MoveConfig& config,
+             bool& accept_higher_prob, default_random_engine& generator) {
+  int move = RandomInt(generator, 2);
   if (move == 0) {
     accept_higher_prob = false;
-    return ExtendPathsRandomly(paths, out_paths, config);
+    return ExtendPathsRandomly(paths, out_paths, config, generator);
   }
   if (move == 1) {
     accept_higher_prob = true;
-    return BreakPaths(paths, out_paths, config);
+    return BreakPaths(paths, out_paths, config, generator);
   }
   return false;
 }
@@ -1,22 +1,38 @@
 #ifndef MOVES_H__
 #define MOVES_H__
 
-#include "path.h"
+#include "path_set.h"
+
+class ExtensionIndex;
 
 class MoveConfig {
  public:
   int big_node_threshold;
   int rand_extend_step_threshold;
   int rand_extend_distance_threshold;
+  // If set (built with the thresholds above), extension moves use it
+  // instead of walking randomly; moves are distributed the same, but failed
+  // extensions are rejected without a walk
+  const ExtensionIndex* extension_index;
 
   MoveConfig() :
     big_node_threshold(500),
     rand_extend_step_threshold(50),
-    rand_extend_distance_threshold(1000)
+    rand_extend_distance_threshold(1000),
+    extension_index(NULL)
     {}
 };
 
-void MakeMove(const vector<Path>& paths, vector<Path>& out_paths, const MoveConfig& config, bool& accept_higher_prob);
-bool TryMove(const vector<Path>& paths, vector<Path>& out_paths, const MoveConfig& config, bool& accept_higher_prob);
+// out_paths share unchanged paths with paths and record the edit (see
+// PathSet::StartChanges).
+void MakeMove(const PathSet& paths, PathSet& out_paths, const MoveConfig& config, bool& accept_higher_prob);
+bool TryMove(const PathSet& paths, PathSet& out_paths, const MoveConfig& config, bool& accept_higher_prob);
+
+// Same as above with all random choices taken from generator, so that
+// independent chains do not share random state.
+void MakeMove(const PathSet& paths, PathSet& out_paths, const MoveConfig& config,
+              bool& accept_higher_prob, default_random_engine& generator);
+bool TryMove(const PathSet& paths, PathSet& out_paths, const MoveConfig& config,
+             bool& accept_higher_prob, default_random_engine& generator);
 
 #endif
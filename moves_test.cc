@@ -22,8 +22,8 @@ TEST(MovesTest, ForceJoinTest) {
   br->AddNext(ar);
   Path p1({a});
   Path p2({b});
-  vector<Path> paths({p1, p2});
-  vector<Path> out_paths;
+  PathSet paths(vector<Path>({p1, p2}));
+  PathSet out_paths;
   MoveConfig config;
   config.big_node_threshold = 5;
   bool accept_higher = false;
@@ -61,8 +61,8 @@ TEST(MovesTest, ForceBreakTest) {
   b->AddNext(c);
   cr->AddNext(br);
   Path p({a, b, c});
-  vector<Path> paths({p});
-  vector<Path> out_paths;
+  PathSet paths(vector<Path>({p}));
+  PathSet out_paths;
   MoveConfig config;
   config.big_node_threshold = 5;
   bool accept_higher = false;
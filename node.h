@@ -1,14 +1,87 @@
 #ifndef NODE_H__
 #define NODE_H__
 
+#include "util.h"
 #include <string>
 #include <fstream>
+#include <ostream>
 #include <vector>
 
 using namespace std;
 
 class Graph;
 
+// Bases of a node. Either owned, or a view into memory which outlives the
+// node (a mapped graph snapshot), optionally read as reverse complement, so
+// that both nodes of a pair can point to one copy of the bases.
+class NodeSequence {
+ public:
+  NodeSequence() : view_(NULL), size_(0), reverse_complement_(false) {}
+  explicit NodeSequence(const string& str) :
+      owned_(str), view_(NULL), size_(str.size()), reverse_complement_(false) {}
+
+  NodeSequence& operator=(const string& str) {
+    assign(str.data(), str.size());
+    return *this;
+  }
+
+  void assign(const char* data, size_t size) {
+    owned_.assign(data, size);
+    view_ = NULL;
+    size_ = size;
+    reverse_complement_ = false;
+  }
+
+  // Points to data[0, size) without copying, read backwards and complemented
+  // if reverse_complement
+  void SetView(const char* data, size_t size, bool reverse_complement) {
+    owned_.clear();
+    view_ = data;
+    size_ = size;
+    reverse_complement_ = reverse_complement;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Stored bases, these are the reverse complement of the sequence if
+  // reverse_complement()
+  const char* data() const { return view_ != NULL ? view_ : owned_.data(); }
+  bool reverse_complement() const { return reverse_complement_; }
+
+  char operator[](size_t i) const {
+    return reverse_complement_ ? ReverseBase(data()[size_ - 1 - i]) : data()[i];
+  }
+
+  string str() const {
+    string ret(data(), size_);
+    if (reverse_complement_) ReverseComplement(data(), size_, &ret[0]);
+    return ret;
+  }
+
+ private:
+  string owned_;
+  const char* view_;
+  size_t size_;
+  bool reverse_complement_;
+};
+
+inline bool operator==(const NodeSequence& a, const NodeSequence& b) {
+  return a.str() == b.str();
+}
+
+inline bool operator==(const NodeSequence& a, const string& b) {
+  return a.str() == b;
+}
+
+inline bool operator==(const string& a, const NodeSequence& b) {
+  return a == b.str();
+}
+
+inline ostream& operator<<(ostream& os, const NodeSequence& s) {
+  return os << s.str();
+}
+
 class Node {
  public:
   Node() {}
@@ -31,7 +104,7 @@ class Node {
     return id_ < 0 ? -id_ : 0;
   }
 
-  string str_;
+  NodeSequence str_;
   int id_;
   Node* rc_;
   vector<Node*> next_;
@@ -18,3 +18,23 @@ TEST(NodeTest, LoadNodeTest) {
   EXPECT_EQ(b, f->rc_);
   EXPECT_EQ(f, b->rc_);
 }
+
+TEST(NodeTest, SequenceViewTest) {
+  const char bases[] = "AACGN";
+  NodeSequence s;
+  s.SetView(bases, 5, true);
+  EXPECT_EQ(5, s.size());
+  EXPECT_EQ(bases, s.data());
+  EXPECT_EQ('N', s[0]);
+  EXPECT_EQ('C', s[1]);
+  EXPECT_EQ("NCGTT", s);
+
+  // Copies keep pointing to the same bases, owned ones are copied
+  NodeSequence t = s;
+  EXPECT_EQ(bases, t.data());
+  s = "ACG";
+  EXPECT_FALSE(s.reverse_complement());
+  NodeSequence u = s;
+  EXPECT_NE(s.data(), u.data());
+  EXPECT_EQ("ACG", u);
+}
@@ -0,0 +1,28 @@
+#include "packed_read_store.h"
+
+void PackedReadStore::Add(const char* seq, int length) {
+  uint64_t pos = offsets_.back();
+  uint64_t end = pos + length;
+  bits_.resize((end + 31) / 32, 0);
+  for (int i = 0; i < length; i++, pos++) {
+    int bits = BaseToBits(seq[i]);
+    if (bits < 0) {
+      exceptions_.push_back(PackedException(pos, seq[i]));
+      bits = 0;
+    }
+    bits_[pos >> 5] |= (uint64_t) bits << (2 * (pos & 31));
+  }
+  offsets_.push_back(end);
+}
+
+void PackedReadStore::Clear() {
+  bits_.clear();
+  offsets_.assign(1, 0);
+  exceptions_.clear();
+}
+
+size_t PackedReadStore::memory_bytes() const {
+  return bits_.capacity() * sizeof(uint64_t) +
+      offsets_.capacity() * sizeof(uint64_t) +
+      exceptions_.capacity() * sizeof(PackedException);
+}
@@ -0,0 +1,131 @@
+#ifndef PACKED_READ_STORE_H__
+#define PACKED_READ_STORE_H__
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "util.h"
+
+using namespace std;
+
+// Base other than ACGT at global position of PackedReadStore
+struct PackedException {
+  PackedException() {}
+  PackedException(uint64_t pos_, char base_) : pos(pos_), base(base_) {}
+  uint64_t pos;
+  char base;
+};
+
+inline bool operator<(const PackedException& a, uint64_t pos) {
+  return a.pos < pos;
+}
+
+// Read stored in PackedReadStore, decodes bases on access. Valid while the
+// store is not modified.
+class PackedRead {
+ public:
+  PackedRead() : bits_(NULL), offset_(0), size_(0), exceptions_(NULL),
+                 num_exceptions_(0) {}
+  PackedRead(const uint64_t* bits, uint64_t offset, int size,
+             const PackedException* exceptions, int num_exceptions) :
+      bits_(bits), offset_(offset), size_(size), exceptions_(exceptions),
+      num_exceptions_(num_exceptions) {}
+
+  int size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  char operator[](int pos) const {
+    uint64_t p = offset_ + pos;
+    if (num_exceptions_ > 0) {
+      const PackedException* e = lower_bound(exceptions_, exceptions_ + num_exceptions_, p);
+      if (e != exceptions_ + num_exceptions_ && e->pos == p) return e->base;
+    }
+    return BitsToBase(bits_[p >> 5] >> (2 * (p & 31)));
+  }
+
+  string str() const {
+    string ret(size_, 'A');
+    for (int i = 0; i < size_; i++) {
+      uint64_t p = offset_ + i;
+      ret[i] = BitsToBase(bits_[p >> 5] >> (2 * (p & 31)));
+    }
+    for (int i = 0; i < num_exceptions_; i++) {
+      ret[exceptions_[i].pos - offset_] = exceptions_[i].base;
+    }
+    return ret;
+  }
+
+ private:
+  const uint64_t* bits_;
+  uint64_t offset_;
+  int size_;
+  const PackedException* exceptions_;
+  int num_exceptions_;
+};
+
+// Reads packed 2 bits per base into one buffer, 32 bases per word, with
+// read boundaries in offset array. Bases other than ACGT are kept in a
+// separate sorted list, as they are rare.
+class PackedReadStore {
+ public:
+  PackedReadStore() : offsets_(1, 0) {}
+
+  void Add(const char* seq, int length);
+
+  void Add(const string& seq) {
+    Add(seq.data(), seq.size());
+  }
+
+  size_t size() const {
+    return offsets_.size() - 1;
+  }
+
+  int length(int i) const {
+    return offsets_[i+1] - offsets_[i];
+  }
+
+  PackedRead operator[](int i) const {
+    const PackedException* exceptions = NULL;
+    int num_exceptions = 0;
+    if (!exceptions_.empty()) {
+      auto begin = lower_bound(exceptions_.begin(), exceptions_.end(), offsets_[i]);
+      auto end = lower_bound(begin, exceptions_.end(), offsets_[i+1]);
+      exceptions = exceptions_.data() + (begin - exceptions_.begin());
+      num_exceptions = end - begin;
+    }
+    return PackedRead(bits_.data(), offsets_[i], length(i), exceptions, num_exceptions);
+  }
+
+  void Clear();
+
+  // Approximate memory used
+  size_t memory_bytes() const;
+
+  // Raw arrays, e.g. for serialization. PackedRead(bits().data(),
+  // offsets()[i], length(i), ...) views read i.
+  const vector<uint64_t>& bits() const {
+    return bits_;
+  }
+
+  const vector<uint64_t>& offsets() const {
+    return offsets_;
+  }
+
+  const vector<PackedException>& exceptions() const {
+    return exceptions_;
+  }
+
+ private:
+  vector<uint64_t> bits_;
+  // Read i has bases [offsets_[i], offsets_[i+1])
+  vector<uint64_t> offsets_;
+  vector<PackedException> exceptions_;
+};
+
+#endif
@@ -0,0 +1,20 @@
+#include "packed_read_store.h"
+#include <gtest/gtest.h>
+
+TEST(PackedReadStoreTest, AddTest) {
+  PackedReadStore store;
+  store.Add("ACGTACGTACGTACGTACGTACGTACGTACGTTT");
+  store.Add("");
+  store.Add("GGNAC");
+  store.Add("TTTT");
+  ASSERT_EQ(4, store.size());
+  EXPECT_EQ(34, store.length(0));
+  EXPECT_EQ("ACGTACGTACGTACGTACGTACGTACGTACGTTT", store[0].str());
+  EXPECT_EQ(0, store.length(1));
+  EXPECT_EQ("", store[1].str());
+  EXPECT_EQ("GGNAC", store[2].str());
+  EXPECT_EQ('N', store[2][2]);
+  EXPECT_EQ('A', store[2][3]);
+  EXPECT_EQ("TTTT", store[3].str());
+  EXPECT_EQ('T', store[3][0]);
+}
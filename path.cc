@@ -1,9 +1,23 @@
 #include "path.h"
 #include "graph.h"
 #include "util.h"
+#include "hash_util.h"
 #include <cassert>
 #include <algorithm>
 #include <sstream>
+#include <unordered_map>
+
+namespace {
+
+int NodesLength(vector<Node*>::const_iterator begin, vector<Node*>::const_iterator end) {
+  int ret = 0;
+  for (auto it = begin; it != end; ++it) {
+    ret += (*it)->str_.size();
+  }
+  return ret;
+}
+
+}  // namespace
 
 vector<Path> BuildPathsFromSingleNodes(const vector<Node*>& nodes) {
   vector<Path> ret;
@@ -49,11 +63,25 @@ string PathsToDebugString(const vector<Path>& paths) {
   return ret.str();
 }
 
+void Path::AppendNode(Node* n) {
+  has_fingerprint_ = false;
+  if (nodes_length_ >= 0) nodes_length_ += n->str_.size();
+  nodes_.push_back(n);
+}
+
 void Path::AppendPath(const Path& p, int p_start) {
+  has_fingerprint_ = false;
+  if (nodes_length_ >= 0) {
+    nodes_length_ += NodesLength(p.nodes_.begin() + p_start, p.nodes_.end());
+  }
   nodes_.insert(nodes_.end(), p.nodes_.begin() + p_start, p.nodes_.end());
 }
 
 void Path::AppendPathWithGap(const Path& p, int gap_length, int p_start) {
+  has_fingerprint_ = false;
+  if (nodes_length_ >= 0) {
+    nodes_length_ += gap_length + NodesLength(p.nodes_.begin() + p_start, p.nodes_.end());
+  }
   nodes_.push_back(MakeGap(gap_length));
   nodes_.insert(nodes_.end(), p.nodes_.begin() + p_start, p.nodes_.end());
 }
@@ -66,28 +94,52 @@ void Path::Reverse() {
   nodes_ = nodes_new;
 }
 
-Path Path::GetReverse() {
+Path Path::GetReverse() const {
   vector<Node*> nodes_new;
   for (int i = nodes_.size() - 1; i >= 0; i--) {
     nodes_new.push_back(nodes_[i]->rc_);
   }
   Path ret;
   ret.nodes_ = nodes_new;
+  // Reverse complement has the same length
+  ret.nodes_length_ = nodes_length_;
   return ret;
 }
 
 string Path::ToString(bool with_endings) const {
-  string ret = "";
+  return View(with_endings).str();
+}
+
+SequenceView Path::View(bool with_endings) const {
+  SequenceView ret;
   if (with_endings) {
     assert((int) nodes_[0]->str_.size() > nodes_[0]->graph_->k_ - 1);
-    ret = ReverseSeq(nodes_[0]->rc_->str_).substr(0, nodes_[0]->graph_->k_ - 1);
+    // First k - 1 bases of reverse complement of the rc node
+    const NodeSequence& rc = nodes_[0]->rc_->str_;
+    int ending_length = min((int) rc.size(), nodes_[0]->graph_->k_ - 1);
+    if (rc.reverse_complement()) {
+      // Stored bases of rc are already the reverse complement
+      ret.Append(rc.data(), ending_length, false);
+    } else {
+      ret.Append(rc.data() + rc.size() - ending_length, ending_length, true);
+    }
   }
-  for (auto &n: nodes_) {    
-    ret += n->str_;
+  for (auto &n: nodes_) {
+    ret.Append(n->str_.data(), n->str_.size(), n->str_.reverse_complement());
   }
   return ret;
 }
 
+int Path::Length(bool with_endings) const {
+  if (nodes_length_ < 0) {
+    nodes_length_ = NodesLength(nodes_.begin(), nodes_.end());
+  }
+  if (with_endings) {
+    return nodes_length_ + nodes_[0]->graph_->k_ - 1;
+  }
+  return nodes_length_;
+}
+
 bool Path::IsSame(const Path& p) const {
   if (p.nodes_.size() != nodes_.size()) return false;
   if (p.nodes_ == nodes_) return true;
@@ -97,14 +149,35 @@ bool Path::IsSame(const Path& p) const {
   return true;
 }
 
+size_t Path::Fingerprint() const {
+  if (has_fingerprint_) return fingerprint_;
+  size_t forward = nodes_.size();
+  size_t backward = nodes_.size();
+  for (size_t i = 0; i < nodes_.size(); i++) {
+    hash_combine(forward, nodes_[i]->id_);
+    Node* rc = nodes_[nodes_.size() - 1 - i]->rc_;
+    hash_combine(backward, rc ? rc->id_ : -1);
+  }
+  fingerprint_ = min(forward, backward);
+  has_fingerprint_ = true;
+  return fingerprint_;
+}
+
 bool Path::ExtendRandomly(int big_node_threshold, int step_threshold, int distance_threshold) {
+  default_random_engine generator(rand());
+  return ExtendRandomly(big_node_threshold, step_threshold, distance_threshold, generator);
+}
+
+bool Path::ExtendRandomly(int big_node_threshold, int step_threshold, int distance_threshold,
+                          default_random_engine& generator) {
+  has_fingerprint_ = false;
   int added_distance = 0;
   int added_steps = 0;
   do {
     Node* last_node = nodes_.back();
     if (last_node->next_.size() == 0) return false;
-    Node* next_node = last_node->next_[rand()%last_node->next_.size()];
-    nodes_.push_back(next_node);
+    Node* next_node = last_node->next_[RandomInt(generator, last_node->next_.size())];
+    AppendNode(next_node);
     if ((int)next_node->str_.size() >= big_node_threshold) {
       return true;
     }
@@ -115,11 +188,15 @@ bool Path::ExtendRandomly(int big_node_threshold, int step_threshold, int distan
 }
 
 Path Path::CutAt(int pos, int big_node_threshold) {
+  has_fingerprint_ = false;
   int part1_end = pos - 1;
   while (!nodes_[part1_end]->IsBig(big_node_threshold)) part1_end--;
   int part2_start = pos;
   while (!nodes_[part2_start]->IsBig(big_node_threshold)) part2_start++;
   Path p2(vector<Node*>(nodes_.begin() + part2_start, nodes_.end()));
+  if (nodes_length_ >= 0) {
+    nodes_length_ -= NodesLength(nodes_.begin() + part1_end + 1, nodes_.end());
+  }
   nodes_ = vector<Node*>(nodes_.begin(), nodes_.begin() + part1_end + 1);
   return p2;
 }
@@ -131,31 +208,45 @@ void PathsToFasta(const vector<Path>& paths, ostream &of) {
   }
 }
 
+namespace {
+
+typedef unordered_multimap<size_t, const Path*> PathIndex;
+
+PathIndex IndexPaths(const vector<Path>& paths) {
+  PathIndex index(paths.size());
+  for (auto &p: paths) {
+    index.insert(make_pair(p.Fingerprint(), &p));
+  }
+  return index;
+}
+
+// Removes one path IsSame as p from index, returns false if there is none
+bool RemovePath(PathIndex& index, const Path& p) {
+  auto range = index.equal_range(p.Fingerprint());
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second->IsSame(p)) {
+      index.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
 void ComparePathSets(const vector<Path>& a,
                      const vector<Path>& b,
                      vector<Path>& added,
                      vector<Path>& removed) {
+  PathIndex a_index = IndexPaths(a);
   for (auto &pb: b) {
-    bool found = false;
-    for (auto &pa: a) {
-      if (pa.IsSame(pb)) {
-        found = true;
-        break;
-      }
-    }
-    if (!found) {
+    if (!RemovePath(a_index, pb)) {
       added.push_back(pb);
     }
   }
+  PathIndex b_index = IndexPaths(b);
   for (auto &pa: a) {
-    bool found = false;
-    for (auto &pb: b) {
-      if (pa.IsSame(pb)) {
-        found = true;
-        break;
-      }
-    }
-    if (!found) {
+    if (!RemovePath(b_index, pa)) {
       removed.push_back(pa);
     }
   }
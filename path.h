@@ -2,14 +2,24 @@
 #define PATH_H__
 
 #include "node.h"
+#include "sequence_view.h"
+#include <random>
+#include <cstddef>
 
 class Path {
  public:
-  Path() {}
-  Path(const vector<Node*> nodes) : nodes_(nodes) {}
+  Path() : fingerprint_(0), has_fingerprint_(false), nodes_length_(-1) {}
+  Path(const vector<Node*> nodes) :
+      nodes_(nodes), fingerprint_(0), has_fingerprint_(false), nodes_length_(-1) {}
   vector<Node*> nodes_;
 
   Node*& operator[](size_t x) {
+    has_fingerprint_ = false;
+    nodes_length_ = -1;
+    return nodes_[x];
+  }
+
+  Node* operator[](size_t x) const {
     return nodes_[x];
   }
 
@@ -18,31 +28,61 @@ class Path {
   }
 
   Node*& back() {
+    has_fingerprint_ = false;
+    nodes_length_ = -1;
+    return nodes_.back();
+  }
+
+  Node* back() const {
     return nodes_.back();
   }
 
   bool CheckPath() const;
 
+  void AppendNode(Node* n);
   void AppendPath(const Path& p, int p_start=0);
   void AppendPathWithGap(const Path &p, int gap_length, int p_start=0);
 
   void Reverse();
-  Path GetReverse();
+  Path GetReverse() const;
 
   string ToDebugString() const;
 
   string ToString(bool with_endings=false) const;
 
+  // Same sequence as ToString, pointing into node strings
+  SequenceView View(bool with_endings=false) const;
+
+  // Same as ToString(with_endings).size(), but does not build the string.
+  // Kept up to date by members which change the path (same caveats as for
+  // Fingerprint).
+  int Length(bool with_endings=false) const;
+
   bool IsSame(const Path& p) const;
 
+  // Hash of node ids which is the same for the path and its reverse, so
+  // paths which are IsSame have equal fingerprints. Cached; members which
+  // change the path reset it, nodes_ should not be modified directly after
+  // the first call. Computing it is not thread safe, call it before sharing
+  // the path between threads.
+  size_t Fingerprint() const;
+
   bool operator==(const Path &p) const {
     return nodes_ == p.nodes_;
   }
 
   bool ExtendRandomly(int big_node_threshold, int step_threshold, int distance_threshold);
+  bool ExtendRandomly(int big_node_threshold, int step_threshold, int distance_threshold,
+                      default_random_engine& generator);
 
   // Split path into <0, pos) and <pos, ...) and removes small nodes from ends
   Path CutAt(int pos, int big_node_threshold);
+
+ private:
+  mutable size_t fingerprint_;
+  mutable bool has_fingerprint_;
+  // Sum of lengths of nodes, -1 if not computed yet
+  mutable int nodes_length_;
 };
 
 vector<Path> BuildPathsFromSingleNodes(const vector<Node*>& nodes);
@@ -51,6 +91,10 @@ string PathsToDebugString(const vector<Path>& paths);
 
 void PathsToFasta(const vector<Path>& paths, ostream &of);
 
+// Difference of a and b as multisets of paths up to IsSame: every path of
+// a is matched with at most one IsSame path of b, unmatched paths of b
+// are added and unmatched paths of a are removed (so removing one of two
+// copies of a path reports it). Linear in total length of paths.
 void ComparePathSets(const vector<Path>& a,
                      const vector<Path>& b,
                      vector<Path>& added,
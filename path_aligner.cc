@@ -1,10 +1,166 @@
 #include "path_aligner.h"
+#include <algorithm>
+#include <limits>
+
+const size_t PathAligner::kDefaultCacheBytes;
 
 vector<ReadAlignment> PathAligner::GetAlignmentsForPath(const Path& p) {
+  bool reversed;
+  vector<int> key = GetCacheKey(p, reversed);
+
+  {
+    lock_guard<mutex> lock(*mutex_);
+    const CachedAlignments* cached = cache_.Get(key);
+    if (cached != NULL) {
+      hits_++;
+      if (cached->reversed == reversed) {
+        return cached->alignments;
+      }
+      return FlipAlignments(cached->alignments, cached->genome_length);
+    }
+    misses_++;
+  }
+
+  // Path sequence is not copied, read set copies only windows around
+  // candidate positions
+  SequenceView genome = p.View(true);
+  CachedAlignments entry;
+  if (incremental_) {
+    entry.alignments = GetAlignmentsIncrementally(p, genome);
+  } else {
+    entry.alignments = read_set_->GetAlignments(genome);
+  }
+  entry.genome_length = genome.size();
+  entry.reversed = reversed;
+
+  size_t cost = sizeof(CachedAlignments) + 2 * key.size() * sizeof(int) +
+      entry.alignments.size() * sizeof(ReadAlignment);
+  lock_guard<mutex> lock(*mutex_);
+  cache_.Put(key, entry, cost);
+  return entry.alignments;
+}
+
+vector<int> PathAligner::GetCacheKey(const Path& p, bool& reversed) {
+  vector<int> forward, backward;
+  forward.reserve(p.size());
+  backward.reserve(p.size());
+  bool has_rc = true;
+  for (auto &n: p.nodes_) {
+    forward.push_back(n->id_);
+    if (n->rc_ == NULL) has_rc = false;
+  }
+  reversed = false;
+  if (!has_rc) return forward;
+  for (int i = p.size() - 1; i >= 0; i--) {
+    backward.push_back(p.nodes_[i]->rc_->id_);
+  }
+  if (backward < forward) {
+    reversed = true;
+    return backward;
+  }
+  return forward;
+}
+
+vector<ReadAlignment> PathAligner::FlipAlignments(
+    const vector<ReadAlignment>& als, int genome_length) const {
   vector<ReadAlignment> ret;
+  ret.reserve(als.size());
+  for (auto &a: als) {
+    ReadAlignment flipped = a;
+    flipped.genome_pos = genome_length - a.genome_pos - read_set_->read_length(a.read_id);
+    flipped.reversed = !a.reversed;
+    ret.push_back(flipped);
+  }
+  return ret;
+}
+
+void PathAligner::AddAlignments(
+    const vector<ReadAlignment>& als, int offset,
+    int min_pos, int max_pos, int min_end, int max_end,
+    vector<ReadAlignment>& output) const {
+  for (auto al: als) {
+    al.genome_pos += offset;
+    int al_end = al.genome_pos + read_set_->read_length(al.read_id);
+    if (al.genome_pos < min_pos || al.genome_pos >= max_pos ||
+        al_end < min_end || al_end > max_end) {
+      continue;
+    }
+    output.push_back(al);
+  }
+}
+
+template<class TKey>
+void PathAligner::AddWindowAlignments(
+    const SequenceView& genome, int start, int end, const TKey& key,
+    LruCache<TKey, vector<ReadAlignment>>& cache,
+    int min_pos, int max_pos, int min_end, int max_end,
+    vector<ReadAlignment>& output) {
+  {
+    lock_guard<mutex> lock(*mutex_);
+    const vector<ReadAlignment>* cached = cache.Get(key);
+    if (cached != NULL) {
+      AddAlignments(*cached, start, min_pos, max_pos, min_end, max_end, output);
+      return;
+    }
+  }
+  vector<ReadAlignment> computed =
+      read_set_->GetAlignments(genome.SubView(start, end - start));
+  AddAlignments(computed, start, min_pos, max_pos, min_end, max_end, output);
+  lock_guard<mutex> lock(*mutex_);
+  cache.Put(key, computed, sizeof(TKey) + (end - start) +
+            computed.size() * sizeof(ReadAlignment));
+}
+
+vector<ReadAlignment> PathAligner::GetAlignmentsIncrementally(
+    const Path& p, const SequenceView& genome) {
+  // Genome is split into segments: the ending prefix and then one segment
+  // per node. Alignment is near a junction (segment boundary) if it starts
+  // less than margin after it or ends less than margin before it. Alignments
+  // near some junction are taken from the window around the first such
+  // junction, others from the segment they lie in. Margin keeps us away from
+  // alignments which are clipped by the end of the segment or window.
+  const int margin = 10;
+  static const int kNoLimit = numeric_limits<int>::max();
 
-  string genome = p.ToString(true);
+  int nodes_length = 0;
+  for (auto &n: p.nodes_) {
+    nodes_length += n->str_.size();
+  }
+  vector<int> boundaries;
+  boundaries.push_back(0);
+  boundaries.push_back(genome.size() - nodes_length);
+  for (auto &n: p.nodes_) {
+    boundaries.push_back(boundaries.back() + n->str_.size());
+  }
+  int num_segments = boundaries.size() - 1;
+
+  vector<ReadAlignment> ret;
+  for (int i = 0; i < num_segments; i++) {
+    int start = boundaries[i];
+    int end = boundaries[i+1];
+    int min_pos = i > 0 ? start + margin : -kNoLimit;
+    int max_end = i + 1 < num_segments ? end - margin : kNoLimit;
+    if (i == 0) {
+      // Ending prefix is short, not worth caching.
+      if (end > 0) {
+        AddAlignments(read_set_->GetAlignments(genome.SubView(0, end)), 0,
+                      min_pos, kNoLimit, -kNoLimit, max_end, ret);
+      }
+      continue;
+    }
+    AddWindowAlignments(genome, start, end, p.nodes_[i-1]->id_, node_cache_,
+                        min_pos, kNoLimit, -kNoLimit, max_end, ret);
+  }
 
-  ret = read_set_->GetAlignments(genome);
+  int window = read_set_->max_read_length() + 2 * margin;
+  for (int i = 1; i < num_segments; i++) {
+    int junction = boundaries[i];
+    int start = max(0, junction - window);
+    int end = min((int) genome.size(), junction + window);
+    int min_pos = i > 1 ? boundaries[i-1] + margin : -kNoLimit;
+    AddWindowAlignments(genome, start, end, genome.substr(start, end - start),
+                        junction_cache_, min_pos, junction + margin,
+                        junction - margin + 1, kNoLimit, ret);
+  }
   return ret;
 }
@@ -3,17 +3,98 @@
 
 #include "read_set.h"
 #include "hash_util.h"
+#include "lru_cache.h"
 #include "path.h"
+#include <memory>
+#include <mutex>
 
-// Handles caching of alignments
+// Handles caching of alignments. GetAlignmentsForPath can be called from
+// many threads at once.
 class PathAligner {
  public:
-  PathAligner() {}
-  PathAligner(ReadSet<>* read_set) : read_set_(read_set) {}
+  PathAligner() : read_set_(NULL), incremental_(false), hits_(0), misses_(0),
+                  mutex_(new mutex) {}
+  // max_cache_bytes is the limit for all caches together. In incremental
+  // mode half of it goes to whole paths and a quarter to nodes and to
+  // junctions each.
+  PathAligner(ReadSet<>* read_set, size_t max_cache_bytes = kDefaultCacheBytes,
+              bool incremental = false) :
+      read_set_(read_set),
+      cache_(incremental ? max_cache_bytes / 2 : max_cache_bytes),
+      node_cache_(incremental ? max_cache_bytes / 4 : 0),
+      junction_cache_(incremental ? max_cache_bytes / 4 : 0),
+      incremental_(incremental), hits_(0), misses_(0), mutex_(new mutex) {}
 
   vector<ReadAlignment> GetAlignmentsForPath(const Path& p);
 
+  size_t max_cache_bytes() const {
+    return cache_.max_cost() + node_cache_.max_cost() + junction_cache_.max_cost();
+  }
+
+  long long hits() const {
+    lock_guard<mutex> lock(*mutex_);
+    return hits_;
+  }
+
+  long long misses() const {
+    lock_guard<mutex> lock(*mutex_);
+    return misses_;
+  }
+
+  static const size_t kDefaultCacheBytes = 256 << 20;
+
   ReadSet<>* read_set_;
+
+ private:
+  struct CachedAlignments {
+    vector<ReadAlignment> alignments;
+    int genome_length;
+    // Whether alignments were computed on path reversed to the cache key
+    bool reversed;
+  };
+
+  // Node ids of path in the orientation which is lexicographically smaller,
+  // so path and its reverse share one cache entry (same as Path::IsSame).
+  // Sets reversed to true if the key was taken from reversed path.
+  static vector<int> GetCacheKey(const Path& p, bool& reversed);
+
+  // Maps alignments from the path to the positions on its reverse
+  vector<ReadAlignment> FlipAlignments(const vector<ReadAlignment>& als,
+                                       int genome_length) const;
+
+  // Assembles alignments of the path from alignments inside single nodes
+  // and alignments crossing node boundaries. Both are cached, so after
+  // extending or cutting a path only reads around changed junctions
+  // are aligned again.
+  vector<ReadAlignment> GetAlignmentsIncrementally(const Path& p,
+                                                   const SequenceView& genome);
+
+  // Shifts alignments by offset and adds those with genome_pos within
+  // [min_pos, max_pos) and end (genome_pos + read length) within
+  // [min_end, max_end].
+  void AddAlignments(const vector<ReadAlignment>& als, int offset,
+                     int min_pos, int max_pos, int min_end, int max_end,
+                     vector<ReadAlignment>& output) const;
+
+  // Same as above for alignments of genome[start, end), which are computed
+  // only if they are not cached under key.
+  template<class TKey>
+  void AddWindowAlignments(const SequenceView& genome, int start, int end,
+                           const TKey& key, LruCache<TKey, vector<ReadAlignment>>& cache,
+                           int min_pos, int max_pos, int min_end, int max_end,
+                           vector<ReadAlignment>& output);
+
+  LruCache<vector<int>, CachedAlignments> cache_;
+  // node id -> alignments inside the node string
+  LruCache<int, vector<ReadAlignment>> node_cache_;
+  // window around junction -> alignments inside window
+  LruCache<string, vector<ReadAlignment>> junction_cache_;
+  bool incremental_;
+  long long hits_;
+  long long misses_;
+  // Guards caches and counters, alignments are computed without holding it.
+  // Pointer keeps PathAligner movable.
+  unique_ptr<mutex> mutex_;
 };
 
 #endif
@@ -0,0 +1,246 @@
+#include "path_aligner.h"
+#include "graph.h"
+#include "util.h"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <algorithm>
+#include <tuple>
+
+namespace {
+
+Graph* MakeTestGraph(string& part1) {
+  part1 = "";
+  char alph[] = "ACGT";
+  srand(47);
+  for (int i = 0; i < 50; i++) {
+    part1 += alph[rand()%4];
+  }
+  // Node strings consistent with k = 41, so reversed path spells reverse
+  // complement of the path.
+  string full = part1 + string(40, 'C') + part1 + string(40, 'A');
+  stringstream ss;
+  ss << "2\t1000\t41\t1\n";
+  ss << "NODE\t1\t180\t0\t0\n";
+  ss << full.substr(40) << endl;
+  ss << ReverseSeq(full).substr(40) << endl;
+  ss << "NODE\t2\t4\t0\t0\n";
+  ss << "AGAC\n";
+  ss << "TGCC\n";
+  ss << "ARC\t1\t2\t44\n";
+  return LoadGraph(ss);
+}
+
+}
+
+TEST(PathAlignerTest, CacheHitTest) {
+  string part1;
+  Graph *g = MakeTestGraph(part1);
+
+  stringstream ss;
+  ss << "@a" << endl << part1 << endl << "+" << endl << part1 << endl;
+  ReadSet<> rs;
+  rs.LoadReadSet(ss);
+
+  PathAligner aligner(&rs);
+  Path p({g->nodes_[0], g->nodes_[2]});
+  vector<ReadAlignment> als1 = aligner.GetAlignmentsForPath(p);
+  EXPECT_EQ(0, aligner.hits());
+  EXPECT_EQ(1, aligner.misses());
+  vector<ReadAlignment> als2 = aligner.GetAlignmentsForPath(p);
+  EXPECT_EQ(1, aligner.hits());
+  EXPECT_EQ(1, aligner.misses());
+  ASSERT_EQ(als1.size(), als2.size());
+  for (size_t i = 0; i < als1.size(); i++) {
+    EXPECT_EQ(als1[i].read_id, als2[i].read_id);
+    EXPECT_EQ(als1[i].genome_pos, als2[i].genome_pos);
+    EXPECT_EQ(als1[i].dist, als2[i].dist);
+    EXPECT_EQ(als1[i].reversed, als2[i].reversed);
+  }
+}
+
+TEST(PathAlignerTest, ReversedPathTest) {
+  string part1;
+  Graph *g = MakeTestGraph(part1);
+
+  stringstream ss;
+  ss << "@a" << endl << part1 << endl << "+" << endl << part1 << endl;
+  ReadSet<> rs;
+  rs.LoadReadSet(ss);
+
+  PathAligner aligner(&rs);
+  Path p({g->nodes_[0]});
+  Path rp = p.GetReverse();
+  vector<ReadAlignment> expected = rs.GetAlignments(rp.ToString(true));
+
+  aligner.GetAlignmentsForPath(p);
+  vector<ReadAlignment> als = aligner.GetAlignmentsForPath(rp);
+  EXPECT_EQ(1, aligner.hits());
+
+  auto cmp = [](const ReadAlignment& a, const ReadAlignment& b) {
+    return a.genome_pos < b.genome_pos;
+  };
+  sort(expected.begin(), expected.end(), cmp);
+  sort(als.begin(), als.end(), cmp);
+  ASSERT_EQ(2, als.size());
+  ASSERT_EQ(expected.size(), als.size());
+  for (size_t i = 0; i < als.size(); i++) {
+    EXPECT_EQ(expected[i].genome_pos, als[i].genome_pos);
+    EXPECT_EQ(expected[i].reversed, als[i].reversed);
+    EXPECT_EQ(expected[i].dist, als[i].dist);
+  }
+}
+
+TEST(PathAlignerTest, EvictionTest) {
+  string part1;
+  Graph *g = MakeTestGraph(part1);
+
+  stringstream ss;
+  ss << "@a" << endl << part1 << endl << "+" << endl << part1 << endl;
+  ReadSet<> rs;
+  rs.LoadReadSet(ss);
+
+  // Too small to hold anything
+  PathAligner aligner(&rs, 1);
+  Path p({g->nodes_[0]});
+  aligner.GetAlignmentsForPath(p);
+  aligner.GetAlignmentsForPath(p);
+  EXPECT_EQ(0, aligner.hits());
+  EXPECT_EQ(2, aligner.misses());
+}
+
+TEST(PathAlignerTest, CacheBudgetTest) {
+  ReadSet<> rs;
+  EXPECT_EQ(1000, PathAligner(&rs, 1000).max_cache_bytes());
+  // Split between path, node and junction caches
+  EXPECT_EQ(1000, PathAligner(&rs, 1000, true).max_cache_bytes());
+}
+
+TEST(LruCacheTest, EvictLeastRecentlyUsedTest) {
+  LruCache<int, int> cache(2);
+  cache.Put(1, 10, 1);
+  cache.Put(2, 20, 1);
+  ASSERT_TRUE(cache.Get(1) != NULL);
+  cache.Put(3, 30, 1);
+  EXPECT_EQ(2, cache.size());
+  EXPECT_TRUE(cache.Get(2) == NULL);
+  ASSERT_TRUE(cache.Get(1) != NULL);
+  EXPECT_EQ(10, *cache.Get(1));
+  ASSERT_TRUE(cache.Get(3) != NULL);
+  EXPECT_EQ(30, *cache.Get(3));
+}
+
+TEST(PathAlignerTest, IncrementalMatchesFullTest) {
+  srand(47);
+  char alph[] = "ACGT";
+  vector<string> full(3);
+  for (auto &f: full) {
+    for (int i = 0; i < 240; i++) {
+      f += alph[rand()%4];
+    }
+  }
+  stringstream ss;
+  ss << "3\t1000\t41\t1\n";
+  for (int i = 0; i < 3; i++) {
+    ss << "NODE\t" << i+1 << "\t200\t0\t0\n";
+    ss << full[i].substr(40) << endl;
+    ss << ReverseSeq(full[i]).substr(40) << endl;
+  }
+  Graph *g = LoadGraph(ss);
+
+  Path p({g->nodes_[0], g->nodes_[3], g->nodes_[4]});
+  string genome = p.ToString(true);
+
+  stringstream reads;
+  for (int i = 0; i < 40; i++) {
+    string read = genome.substr(rand() % (genome.size() - 50), 50);
+    if (rand()%2) read = ReverseSeq(read);
+    reads << "@r" << i << endl << read << endl << "+" << endl << read << endl;
+  }
+  ReadSet<> rs;
+  rs.LoadReadSet(reads);
+
+  PathAligner full_aligner(&rs);
+  PathAligner incremental_aligner(&rs, PathAligner::kDefaultCacheBytes, true);
+
+  auto key = [](const ReadAlignment& a) {
+    return make_tuple(a.read_id, a.genome_pos, a.reversed, a.dist);
+  };
+  auto cmp = [&key](const ReadAlignment& a, const ReadAlignment& b) {
+    return key(a) < key(b);
+  };
+  vector<Path> paths({p, Path({g->nodes_[0], g->nodes_[3]}), Path({g->nodes_[3], g->nodes_[4]})});
+  for (auto &path: paths) {
+    vector<ReadAlignment> expected = full_aligner.GetAlignmentsForPath(path);
+    vector<ReadAlignment> als = incremental_aligner.GetAlignmentsForPath(path);
+    sort(expected.begin(), expected.end(), cmp);
+    sort(als.begin(), als.end(), cmp);
+    ASSERT_EQ(expected.size(), als.size());
+    for (size_t i = 0; i < als.size(); i++) {
+      EXPECT_EQ(key(expected[i]), key(als[i]));
+    }
+  }
+}
+
+TEST(PathAlignerTest, ConcurrentTest) {
+  srand(47);
+  char alph[] = "ACGT";
+  vector<string> full(3);
+  for (auto &f: full) {
+    for (int i = 0; i < 240; i++) {
+      f += alph[rand()%4];
+    }
+  }
+  stringstream ss;
+  ss << "3\t1000\t41\t1\n";
+  for (int i = 0; i < 3; i++) {
+    ss << "NODE\t" << i+1 << "\t200\t0\t0\n";
+    ss << full[i].substr(40) << endl;
+    ss << ReverseSeq(full[i]).substr(40) << endl;
+  }
+  Graph *g = LoadGraph(ss);
+  Path p({g->nodes_[0], g->nodes_[3], g->nodes_[4]});
+  string genome = p.ToString(true);
+
+  stringstream reads;
+  for (int i = 0; i < 40; i++) {
+    string read = genome.substr(rand() % (genome.size() - 50), 50);
+    reads << "@r" << i << endl << read << endl << "+" << endl << read << endl;
+  }
+  ReadSet<> rs;
+  rs.LoadReadSet(reads);
+
+  vector<Path> paths({p, Path({g->nodes_[0], g->nodes_[3]}),
+                      Path({g->nodes_[3], g->nodes_[4]}), Path({g->nodes_[0]})});
+  PathAligner serial_aligner(&rs);
+  vector<vector<ReadAlignment>> expected;
+  for (auto &path: paths) {
+    expected.push_back(serial_aligner.GetAlignmentsForPath(path));
+  }
+
+  // Same paths many times from many threads, in both modes
+  ThreadPool pool(4);
+  for (bool incremental: {false, true}) {
+    PathAligner aligner(&rs, PathAligner::kDefaultCacheBytes, incremental);
+    vector<vector<ReadAlignment>> als(40);
+    pool.ParallelFor(als.size(), [&](int i) {
+      als[i] = aligner.GetAlignmentsForPath(paths[i % paths.size()]);
+    });
+    auto key = [](const ReadAlignment& a) {
+      return make_tuple(a.read_id, a.genome_pos, a.reversed, a.dist);
+    };
+    auto cmp = [&key](const ReadAlignment& a, const ReadAlignment& b) {
+      return key(a) < key(b);
+    };
+    for (size_t i = 0; i < als.size(); i++) {
+      vector<ReadAlignment> expected_als = expected[i % paths.size()];
+      // Incremental mode assembles the same alignments in other order
+      sort(expected_als.begin(), expected_als.end(), cmp);
+      sort(als[i].begin(), als[i].end(), cmp);
+      ASSERT_EQ(expected_als.size(), als[i].size());
+      for (size_t j = 0; j < als[i].size(); j++) {
+        EXPECT_EQ(key(expected_als[j]), key(als[i][j]));
+      }
+    }
+    EXPECT_EQ(40, aligner.hits() + aligner.misses());
+  }
+}
@@ -0,0 +1,229 @@
+#include "path_set.h"
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+// Paths are shared between threads, so the fingerprint and length are
+// cached before that.
+shared_ptr<const Path> MakeSharedPath(const Path& p) {
+  shared_ptr<const Path> ret = make_shared<const Path>(p);
+  ret->Fingerprint();
+  ret->Length();
+  return ret;
+}
+
+}  // namespace
+
+PathSet::PathSet(const vector<Path>& paths) :
+    version_(NextVersion()), base_version_(0) {
+  paths_.reserve(paths.size());
+  for (auto &p: paths) {
+    paths_.push_back(MakeSharedPath(p));
+  }
+  for (size_t i = 0; i < paths_.size(); i++) {
+    const Path& p = *paths_[i];
+    if (p.size() == 0) continue;
+    endpoints_.push_back(Endpoint(p[0], 2 * i));
+    if (p.back()->rc_ != NULL) {
+      endpoints_.push_back(Endpoint(p.back()->rc_, 2 * i + 1));
+    }
+  }
+  sort(endpoints_.begin(), endpoints_.end());
+}
+
+uint64_t PathSet::NextVersion() {
+  static atomic<uint64_t> next_version(1);
+  return next_version++;
+}
+
+void PathSet::Changed() {
+  version_ = NextVersion();
+}
+
+void PathSet::RecordAdded(const shared_ptr<const Path>& p) {
+  added_.push_back(p);
+}
+
+void PathSet::RecordRemoved(const shared_ptr<const Path>& p) {
+  // Path added in this edit and removed again was never in the base
+  auto it = find(added_.begin(), added_.end(), p);
+  if (it != added_.end()) {
+    added_.erase(it);
+  } else {
+    removed_.push_back(p);
+  }
+}
+
+void PathSet::AddEndpoints(int i) {
+  const Path& p = *paths_[i];
+  if (p.size() == 0) return;
+  Endpoint start(p[0], 2 * i);
+  endpoints_.insert(upper_bound(endpoints_.begin(), endpoints_.end(), start), start);
+  if (p.back()->rc_ != NULL) {
+    Endpoint end(p.back()->rc_, 2 * i + 1);
+    endpoints_.insert(upper_bound(endpoints_.begin(), endpoints_.end(), end), end);
+  }
+}
+
+void PathSet::RemoveEndpoints(int i) {
+  const Path& p = *paths_[i];
+  if (p.size() == 0) return;
+  auto it = lower_bound(endpoints_.begin(), endpoints_.end(), Endpoint(p[0], 2 * i));
+  endpoints_.erase(it);
+  if (p.back()->rc_ != NULL) {
+    it = lower_bound(endpoints_.begin(), endpoints_.end(), Endpoint(p.back()->rc_, 2 * i + 1));
+    endpoints_.erase(it);
+  }
+}
+
+void PathSet::Replace(size_t i, const Path& p) {
+  RecordRemoved(paths_[i]);
+  RemoveEndpoints(i);
+  paths_[i] = MakeSharedPath(p);
+  AddEndpoints(i);
+  RecordAdded(paths_[i]);
+  Changed();
+}
+
+void PathSet::Add(const Path& p) {
+  paths_.push_back(MakeSharedPath(p));
+  AddEndpoints(paths_.size() - 1);
+  RecordAdded(paths_.back());
+  Changed();
+}
+
+void PathSet::Remove(size_t i) {
+  RecordRemoved(paths_[i]);
+  RemoveEndpoints(i);
+  size_t last = paths_.size() - 1;
+  if (i != last) {
+    RemoveEndpoints(last);
+    paths_[i] = paths_[last];
+    AddEndpoints(i);
+  }
+  paths_.pop_back();
+  Changed();
+}
+
+void PathSet::FindPathsStartingWith(const Node* n, vector<pair<int, bool>>& output) const {
+  auto it = lower_bound(endpoints_.begin(), endpoints_.end(), Endpoint(n, 0));
+  for (; it != endpoints_.end() && it->first == n; ++it) {
+    int i = it->second / 2;
+    bool reversed = it->second % 2;
+    // Forward entry of the same path comes right before
+    if (reversed && (*paths_[i])[0] == n) continue;
+    output.push_back(make_pair(i, reversed));
+  }
+}
+
+vector<Path> PathSet::ToVector() const {
+  vector<Path> ret;
+  ret.reserve(paths_.size());
+  for (auto &p: paths_) {
+    ret.push_back(*p);
+  }
+  return ret;
+}
+
+void PathSet::StartChanges() {
+  base_version_ = version_;
+  added_.clear();
+  removed_.clear();
+}
+
+string PathsToDebugString(const PathSet& paths) {
+  stringstream ret;
+  ret << paths.size() << " paths:  ";
+  for (size_t i = 0; i < paths.size(); i++) {
+    ret << paths[i].ToDebugString();
+    if (i + 1 != paths.size()) {
+      ret << "   ";
+    }
+  }
+  return ret.str();
+}
+
+void PathsToFasta(const PathSet& paths, ostream &of) {
+  for (size_t i = 0; i < paths.size(); i++) {
+    of << ">" << paths[i].ToDebugString() << endl;
+    of << paths[i].ToString(true) << endl;
+  }
+}
+
+namespace {
+
+typedef unordered_multimap<size_t, const Path*> PathIndex;
+
+// Appends paths of b left after matching each path of a with at most one
+// IsSame path of b (difference of multisets, as ComparePathSets for
+// vectors). Paths shared by pointer are matched first, without comparing.
+void AppendMissing(const vector<const Path*>& a, const vector<const Path*>& b,
+                   vector<Path>& out) {
+  // Unmatched copies of each path of a
+  unordered_map<const Path*, int> a_ptrs;
+  for (auto p: a) a_ptrs[p]++;
+  vector<const Path*> b_rest;
+  for (auto p: b) {
+    auto it = a_ptrs.find(p);
+    if (it != a_ptrs.end() && it->second > 0) {
+      it->second--;
+    } else {
+      b_rest.push_back(p);
+    }
+  }
+  if (b_rest.empty()) return;
+
+  PathIndex a_index(a.size());
+  for (auto &entry: a_ptrs) {
+    for (int i = 0; i < entry.second; i++) {
+      a_index.insert(make_pair(entry.first->Fingerprint(), entry.first));
+    }
+  }
+  for (auto p: b_rest) {
+    auto range = a_index.equal_range(p->Fingerprint());
+    auto it = range.first;
+    while (it != range.second && !it->second->IsSame(*p)) ++it;
+    if (it != range.second) {
+      a_index.erase(it);
+    } else {
+      out.push_back(*p);
+    }
+  }
+}
+
+vector<const Path*> GetPointers(const vector<shared_ptr<const Path>>& paths) {
+  vector<const Path*> ret;
+  ret.reserve(paths.size());
+  for (auto &p: paths) ret.push_back(p.get());
+  return ret;
+}
+
+vector<const Path*> GetPointers(const PathSet& paths) {
+  vector<const Path*> ret;
+  ret.reserve(paths.size());
+  for (size_t i = 0; i < paths.size(); i++) ret.push_back(&paths[i]);
+  return ret;
+}
+
+}  // namespace
+
+void ComparePathSets(const PathSet& a,
+                     const PathSet& b,
+                     vector<Path>& added,
+                     vector<Path>& removed) {
+  if (b.base_version() != 0 && b.base_version() == a.version()) {
+    // Edit may replace a path with the same one (e.g. reversed)
+    vector<const Path*> b_added = GetPointers(b.added());
+    vector<const Path*> b_removed = GetPointers(b.removed());
+    AppendMissing(b_removed, b_added, added);
+    AppendMissing(b_added, b_removed, removed);
+    return;
+  }
+  vector<const Path*> a_paths = GetPointers(a);
+  vector<const Path*> b_paths = GetPointers(b);
+  AppendMissing(a_paths, b_paths, added);
+  AppendMissing(b_paths, a_paths, removed);
+}
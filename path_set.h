@@ -0,0 +1,107 @@
+#ifndef PATH_SET_H__
+#define PATH_SET_H__
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "path.h"
+
+using namespace std;
+
+// Collection of paths whose copies share the (immutable) paths, so copying
+// it copies only pointers and changing it allocates only the edited paths.
+// Order of paths has no meaning.
+//
+// Every state of a set has a unique version. After StartChanges the set
+// records which paths were added and removed since, so a set derived from
+// another one can be diffed against it in time of the edit.
+class PathSet {
+ public:
+  PathSet() : version_(NextVersion()), base_version_(0) {}
+  PathSet(const vector<Path>& paths);
+
+  size_t size() const {
+    return paths_.size();
+  }
+
+  bool empty() const {
+    return paths_.empty();
+  }
+
+  const Path& operator[](size_t i) const {
+    return *paths_[i];
+  }
+
+  // Shared pointer to i-th path, stays valid after the set changes
+  const shared_ptr<const Path>& ptr(size_t i) const {
+    return paths_[i];
+  }
+
+  void Replace(size_t i, const Path& p);
+  void Add(const Path& p);
+  // Moves the last path to position i
+  void Remove(size_t i);
+
+  vector<Path> ToVector() const;
+
+  // Appends (index, reversed) of paths which start with node n, or whose
+  // reverse does (then reversed is true), in order of index. Path
+  // starting with n both ways is reported once, not reversed.
+  void FindPathsStartingWith(const Node* n, vector<pair<int, bool>>& output) const;
+
+  // Current state becomes the base for added() and removed()
+  void StartChanges();
+
+  uint64_t version() const {
+    return version_;
+  }
+
+  // Version of the set at the last StartChanges, 0 if never called
+  uint64_t base_version() const {
+    return base_version_;
+  }
+
+  // Paths added and removed since StartChanges
+  const vector<shared_ptr<const Path>>& added() const {
+    return added_;
+  }
+
+  const vector<shared_ptr<const Path>>& removed() const {
+    return removed_;
+  }
+
+ private:
+  static uint64_t NextVersion();
+
+  void Changed();
+  void RecordAdded(const shared_ptr<const Path>& p);
+  void RecordRemoved(const shared_ptr<const Path>& p);
+
+  // (first node of the path or of its reverse, 2 * index + reversed)
+  typedef pair<const Node*, int> Endpoint;
+
+  void AddEndpoints(int i);
+  void RemoveEndpoints(int i);
+
+  vector<shared_ptr<const Path>> paths_;
+  // Sorted. Flat, so copying the set stays a plain copy.
+  vector<Endpoint> endpoints_;
+  uint64_t version_;
+  uint64_t base_version_;
+  vector<shared_ptr<const Path>> added_;
+  vector<shared_ptr<const Path>> removed_;
+};
+
+string PathsToDebugString(const PathSet& paths);
+
+void PathsToFasta(const PathSet& paths, ostream &of);
+
+// Same as ComparePathSets for vectors (also for copies of one path). If b
+// was derived from a (a is the base of b's changes) only the change list
+// of b is used.
+void ComparePathSets(const PathSet& a,
+                     const PathSet& b,
+                     vector<Path>& added,
+                     vector<Path>& removed);
+
+#endif
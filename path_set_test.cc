@@ -0,0 +1,145 @@
+#include "path_set.h"
+#include <gtest/gtest.h>
+
+namespace {
+
+// Nodes a, b, c with their reverse complements
+vector<Node*> MakeNodes() {
+  vector<Node*> nodes;
+  for (int i = 0; i < 3; i++) {
+    Node* f = new Node;
+    f->id_ = 2 * i;
+    Node* r = new Node;
+    r->id_ = 2 * i + 1;
+    f->rc_ = r;
+    r->rc_ = f;
+    nodes.push_back(f);
+    nodes.push_back(r);
+  }
+  return nodes;
+}
+
+}  // namespace
+
+TEST(PathSetTest, SharingTest) {
+  vector<Node*> n = MakeNodes();
+  PathSet paths(vector<Path>({Path({n[0]}), Path({n[2]}), Path({n[4]})}));
+  PathSet copy = paths;
+  EXPECT_EQ(paths.version(), copy.version());
+  copy.Replace(1, Path({n[2], n[4]}));
+  EXPECT_NE(paths.version(), copy.version());
+  EXPECT_EQ(paths.ptr(0).get(), copy.ptr(0).get());
+  EXPECT_EQ(paths.ptr(2).get(), copy.ptr(2).get());
+  EXPECT_EQ(Path({n[2]}), paths[1]);
+  EXPECT_EQ(Path({n[2], n[4]}), copy[1]);
+}
+
+TEST(PathSetTest, ChangesTest) {
+  vector<Node*> n = MakeNodes();
+  PathSet paths(vector<Path>({Path({n[0]}), Path({n[2]}), Path({n[4]})}));
+  PathSet out = paths;
+  out.StartChanges();
+  EXPECT_EQ(paths.version(), out.base_version());
+  out.Replace(0, Path({n[0], n[2]}));
+  out.Remove(1);
+  out.Add(Path({n[5]}));
+  out.Remove(out.size() - 1);
+  EXPECT_EQ(2, out.size());
+  ASSERT_EQ(1, out.added().size());
+  EXPECT_EQ(Path({n[0], n[2]}), *out.added()[0]);
+  ASSERT_EQ(2, out.removed().size());
+  EXPECT_EQ(Path({n[0]}), *out.removed()[0]);
+  EXPECT_EQ(Path({n[2]}), *out.removed()[1]);
+}
+
+TEST(PathSetTest, ComparePathSetsTest) {
+  vector<Node*> n = MakeNodes();
+  PathSet paths(vector<Path>({Path({n[0], n[2]}), Path({n[4]})}));
+  PathSet out = paths;
+  out.StartChanges();
+  // Same path in other direction
+  out.Replace(0, Path({n[3], n[1]}));
+  out.Add(Path({n[0]}));
+  out.Remove(1);
+
+  vector<Path> added, removed;
+  ComparePathSets(paths, out, added, removed);
+  EXPECT_EQ(vector<Path>({Path({n[0]})}), added);
+  EXPECT_EQ(vector<Path>({Path({n[4]})}), removed);
+
+  // Sets not derived from each other give the same result
+  vector<Path> added2, removed2;
+  ComparePathSets(PathSet(paths.ToVector()), PathSet(out.ToVector()), added2, removed2);
+  EXPECT_EQ(added, added2);
+  EXPECT_EQ(removed, removed2);
+}
+
+TEST(PathSetTest, ComparePathSetsDuplicatesTest) {
+  vector<Node*> n = MakeNodes();
+  // Two copies of one path, one of them reversed
+  PathSet paths(vector<Path>({Path({n[0], n[2]}), Path({n[4]}), Path({n[3], n[1]})}));
+  PathSet out = paths;
+  out.StartChanges();
+  out.Remove(2);
+  vector<Path> expected_removed({Path({n[3], n[1]})});
+
+  vector<Path> added, removed;
+  ComparePathSets(paths, out, added, removed);
+  EXPECT_TRUE(added.empty());
+  EXPECT_EQ(expected_removed, removed);
+
+  // Full comparison, with shared paths and with copies
+  PathSet other = out;
+  other.StartChanges();
+  vector<Path> added2, removed2;
+  ComparePathSets(paths, other, added2, removed2);
+  EXPECT_TRUE(added2.empty());
+  EXPECT_EQ(1, removed2.size());
+  EXPECT_TRUE(removed2[0].IsSame(Path({n[0], n[2]})));
+  vector<Path> added3, removed3;
+  ComparePathSets(PathSet(paths.ToVector()), PathSet(out.ToVector()), added3, removed3);
+  EXPECT_TRUE(added3.empty());
+  EXPECT_EQ(expected_removed, removed3);
+  vector<Path> added4, removed4;
+  ComparePathSets(paths.ToVector(), out.ToVector(), added4, removed4);
+  EXPECT_TRUE(added4.empty());
+  EXPECT_EQ(expected_removed, removed4);
+
+  // Copy added back
+  vector<Path> added5, removed5;
+  ComparePathSets(out, paths, added5, removed5);
+  EXPECT_EQ(expected_removed, added5);
+  EXPECT_TRUE(removed5.empty());
+}
+
+TEST(PathSetTest, FindPathsStartingWithTest) {
+  vector<Node*> n = MakeNodes();
+  // a; b c; a b
+  PathSet paths(vector<Path>({Path({n[0]}), Path({n[2], n[4]}), Path({n[0], n[2]})}));
+  vector<pair<int, bool>> found;
+  paths.FindPathsStartingWith(n[0], found);
+  // Reverse of path a starts with rc of a, so only the forward one is found
+  EXPECT_EQ((vector<pair<int, bool>>({{0, false}, {2, false}})), found);
+
+  found.clear();
+  paths.FindPathsStartingWith(n[5], found);
+  EXPECT_EQ((vector<pair<int, bool>>({{1, true}})), found);
+
+  paths.Remove(0);
+  paths.Replace(0, Path({n[3], n[1]}));
+  found.clear();
+  paths.FindPathsStartingWith(n[0], found);
+  EXPECT_EQ((vector<pair<int, bool>>({{0, true}})), found);
+  found.clear();
+  paths.FindPathsStartingWith(n[2], found);
+  EXPECT_EQ((vector<pair<int, bool>>({{1, false}})), found);
+  found.clear();
+  paths.FindPathsStartingWith(n[3], found);
+  EXPECT_EQ((vector<pair<int, bool>>({{0, false}})), found);
+
+  // a b rc(a) starts with a both ways, but is reported once
+  paths.Add(Path({n[0], n[2], n[1]}));
+  found.clear();
+  paths.FindPathsStartingWith(n[0], found);
+  EXPECT_EQ((vector<pair<int, bool>>({{0, true}, {2, false}})), found);
+}
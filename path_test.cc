@@ -156,13 +156,46 @@ TEST(PathTest, PathToStringTest) {
 
   Path p2({g->nodes_[0], g->nodes_[2]});
   string str_out3 = p2.ToString(false);
-  EXPECT_EQ(g->nodes_[0]->str_ + g->nodes_[2]->str_, str_out3);
+  EXPECT_EQ(g->nodes_[0]->str_.str() + g->nodes_[2]->str_.str(), str_out3);
   string str_out4 = p2.ToString(true);
   EXPECT_EQ("TTTCATAGAAAGCATTTTGTTGTTCTTTGTTGAATTTGTT"
             "GTCAGCTTTTGGTGCTTGAGCATCATTTAGCTTTTTAGCTTCTGCTAAAAGGTTAGCGCTTTGGCTTGGGTCATCTTTTAGGCTTTGGATGAAACCATTGCGTTGTTCTTCGTTTAAGTTAAGAC",
             str_out4);
 }
 
+TEST(PathTest, LengthTest) {
+  stringstream ss;
+  ss << "2\t1000\t41\t1\n";
+  ss << "NODE\t1\t121\t0\t0\n";
+  ss << "GTCAGCTTTTGGTGCTTGAGCATCATTTAGCTTTTTAGCTTCTGCTAAAAGGTTAGCGCTTTGGCTTGGGTCATCTTTTAGGCTTTGGATGAAACCATTGCGTTGTTCTTCGTTTAAGTTA\n";
+  ss << "CTAAAAGATGACCCAAGCCAAAGCGCTAACCTTTTAGCAGAAGCTAAAAAGCTAAATGATGCTCAAGCACCAAAAGCTGACAACAAATTCAACAAAGAACAACAAAATGCTTTCTATGAAA\n";
+  ss << "NODE\t2\t4\t0\t0\n";
+  ss << "AGAC\n";
+  ss << "TGCC\n";
+  ss << "ARC\t1\t-2\t44\n";
+  Graph *g = LoadGraph(ss);
+
+  Path p({g->nodes_[0]});
+  EXPECT_EQ(p.ToString(false).size(), p.Length(false));
+  EXPECT_EQ(p.ToString(true).size(), p.Length(true));
+  p.AppendPath(Path({g->nodes_[0], g->nodes_[2]}), 1);
+  EXPECT_EQ(p.ToString(true).size(), p.Length(true));
+  p.AppendPathWithGap(Path({g->nodes_[0]}), 10);
+  EXPECT_EQ(p.ToString(true).size(), p.Length(true));
+  EXPECT_EQ(p.ToString(true).size(), p.GetReverse().Length(true));
+  Path p2 = p.CutAt(2, 100);
+  EXPECT_EQ(p.ToString(true).size(), p.Length(true));
+  EXPECT_EQ(p2.ToString(true).size(), p2.Length(true));
+
+  // Nodes set directly on an empty path
+  Path p3;
+  p3.nodes_ = {g->nodes_[0], g->nodes_[2]};
+  EXPECT_EQ(125, p3.Length(false));
+  Path p4;
+  p4.nodes_.push_back(g->nodes_[2]);
+  EXPECT_EQ(4, p4.Length(false));
+}
+
 TEST(PathTest, PathToStringTest2) {
   stringstream ss;
   ss << "2\t1000\t41\t1\n";
@@ -180,7 +213,7 @@ TEST(PathTest, PathToStringTest2) {
   p1.AppendPathWithGap(p2, 50);
   string str_out1 = p1.ToString(false);
   EXPECT_EQ(121+50+4, str_out1.size());
-  EXPECT_EQ(g->nodes_[0]->str_ + string(50, 'N') + g->nodes_[2]->str_, str_out1);
+  EXPECT_EQ(g->nodes_[0]->str_.str() + string(50, 'N') + g->nodes_[2]->str_.str(), str_out1);
   string str_out2 = p1.ToString(true);
   EXPECT_EQ(161+50+4, str_out2.size());
   EXPECT_EQ("TTTCATAGAAAGCATTTTGTTGTTCTTTGTTGAATTTGTT"
@@ -189,6 +222,24 @@ TEST(PathTest, PathToStringTest2) {
             str_out2);
 }
 
+TEST(PathTest, PathToStringSharedBasesTest) {
+  // Velvet pair with k = 3 pointing into sequence "ACGTTG", as in a snapshot
+  const char bases[] = "ACGTTG";
+  Graph g;
+  g.k_ = 3;
+  g.AllocateNodePairs(1);
+  g.nodes_[0]->str_.SetView(bases + 2, 4, false);
+  g.nodes_[1]->str_.SetView(bases, 4, true);
+  EXPECT_EQ("ACGT", g.nodes_[1]->str_);
+
+  Path p({g.nodes_[0]});
+  EXPECT_EQ("GTTG", p.ToString(false));
+  EXPECT_EQ("ACGTTG", p.ToString(true));
+  Path rp({g.nodes_[1]});
+  EXPECT_EQ("ACGT", rp.ToString(false));
+  EXPECT_EQ("CAACGT", rp.ToString(true));
+}
+
 TEST(PathTest, IsSamePathTest1) {
   Node* a = new Node;
   a->id_ = 1;
@@ -284,6 +335,32 @@ TEST(PathTest, IsSamePathTest5) {
   EXPECT_EQ(false, p2.IsSame(p));
 }
 
+TEST(PathTest, FingerprintTest) {
+  Node* a = new Node;
+  a->id_ = 1;
+  Node* b = new Node;
+  b->id_ = 2;
+  a->rc_ = b;
+  b->rc_ = a;
+  Node* c = new Node;
+  c->id_ = 3;
+  Node* d = new Node;
+  d->id_ = 4;
+  c->rc_ = d;
+  d->rc_ = c;
+  Path p({a, c});
+  Path p2({d, b});
+  EXPECT_EQ(p.Fingerprint(), p2.Fingerprint());
+  EXPECT_NE(p.Fingerprint(), Path({c, a}).Fingerprint());
+  size_t old_fingerprint = p.Fingerprint();
+  p.AppendPath(Path({a}));
+  EXPECT_NE(old_fingerprint, p.Fingerprint());
+  EXPECT_EQ(p.Fingerprint(), p.GetReverse().Fingerprint());
+  old_fingerprint = p.Fingerprint();
+  p.AppendPathWithGap(Path({c}), 10);
+  EXPECT_NE(old_fingerprint, p.Fingerprint());
+}
+
 TEST(PathTest, ComparePathSetsTest) {
   Node* a = new Node;
   a->id_ = 1;
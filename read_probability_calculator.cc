@@ -4,14 +4,20 @@
 #include <cassert>
 
 double SingleReadProbabilityCalculator::GetPathsProbability(
-    const vector<Path>& paths, ProbabilityChange& prob_change) {
+    const PathSet& paths, ProbabilityChange& prob_change) {
   prob_change.added_paths.clear();
   prob_change.removed_paths.clear();
   prob_change.added_alignments.clear();
   prob_change.removed_alignments.clear();
   ComparePathSets(old_paths_, paths, prob_change.added_paths, prob_change.removed_paths);
 
-  prob_change.new_paths_length = GetPathsLength(paths);
+  // Total length changes only by lengths of added and removed paths
+  if (old_paths_.empty()) {
+    prob_change.new_paths_length = GetPathsLength(paths);
+  } else {
+    prob_change.new_paths_length = old_paths_length_ +
+        GetPathsLength(prob_change.added_paths) - GetPathsLength(prob_change.removed_paths);
+  }
   prob_change.new_paths = paths;
 
   EvalProbabilityChange(prob_change);
@@ -21,21 +27,21 @@ double SingleReadProbabilityCalculator::GetPathsProbability(
 
 void SingleReadProbabilityCalculator::EvalProbabilityChange(
     ProbabilityChange& prob_change) {
-  for (size_t i = 0; i < prob_change.added_paths.size(); i++) {
-    auto &p = prob_change.added_paths[i];
-    auto als = path_aligner_.GetAlignmentsForPath(p);
-    prob_change.added_alignments.insert(prob_change.added_alignments.end(), als.begin(), als.end()); 
-    printf("\rdone %d/%d evals", (int) i+1, (int) prob_change.added_paths.size()); 
-    fflush(stdout);
-  }
-  for (size_t i = 0; i < prob_change.removed_paths.size(); i++) {
-    auto &p = prob_change.removed_paths[i];
-    auto als = path_aligner_.GetAlignmentsForPath(p);
-    prob_change.removed_alignments.insert(prob_change.removed_alignments.end(), als.begin(), als.end()); 
-    printf("\rdone %d/%d evals", (int) i+1, (int) prob_change.removed_paths.size()); 
-    fflush(stdout);
+  // Paths are aligned concurrently and alignments joined in order, added
+  // paths first.
+  int num_added = prob_change.added_paths.size();
+  int num_paths = num_added + prob_change.removed_paths.size();
+  vector<vector<ReadAlignment>> path_alignments(num_paths);
+  ParallelFor(read_set_->thread_pool(), num_paths, [&](int i) {
+    const Path& p = i < num_added ? prob_change.added_paths[i] :
+        prob_change.removed_paths[i - num_added];
+    path_alignments[i] = path_aligner_->GetAlignmentsForPath(p);
+  });
+  for (int i = 0; i < num_paths; i++) {
+    auto& output = i < num_added ? prob_change.added_alignments :
+        prob_change.removed_alignments;
+    output.insert(output.end(), path_alignments[i].begin(), path_alignments[i].end());
   }
-  printf("\n");
 }
 
 double SingleReadProbabilityCalculator::EvalTotalProbabilityFromChange(
@@ -44,45 +50,73 @@ double SingleReadProbabilityCalculator::EvalTotalProbabilityFromChange(
   new_prob += log(old_paths_length_);
   new_prob -= log(prob_change.new_paths_length);
 
-  // (read_id, prob_change)
-  vector<pair<int, double>> changes;
+  unique_ptr<DeltaAccumulator<double>> deltas = AcquireDeltas();
   for (auto &a: prob_change.added_alignments) {
-    changes.push_back(make_pair(a.read_id, GetAlignmentProb(a.dist, (*read_set_)[a.read_id].size())));
+    deltas->Add(a.read_id, GetAlignmentProb(a.dist, read_set_->read_length(a.read_id)));
   }
   for (auto &a: prob_change.removed_alignments) {
-    changes.push_back(make_pair(a.read_id, -GetAlignmentProb(a.dist, (*read_set_)[a.read_id].size())));
-  }
-  sort(changes.begin(), changes.end());
-  int last_read_id = -47;
-  double accumulated_prob = 0;
-  for (auto &ch: changes) {
-    if (ch.first != last_read_id && last_read_id != -47) {
-      new_prob -= GetRealReadProbability(read_probs_[last_read_id], last_read_id) / read_set_->size();
-      new_prob += GetRealReadProbability(read_probs_[last_read_id] + accumulated_prob, last_read_id) / read_set_->size();
-      if (write) {
-        read_probs_[last_read_id] += accumulated_prob;
-      }
-      accumulated_prob = 0;
-    }
-    accumulated_prob += ch.second;
-    last_read_id = ch.first;
+    deltas->Add(a.read_id, -GetAlignmentProb(a.dist, read_set_->read_length(a.read_id)));
   }
-  if (last_read_id != -47) {
-    new_prob -= GetRealReadProbability(read_probs_[last_read_id], last_read_id) / read_set_->size();
-    new_prob += GetRealReadProbability(read_probs_[last_read_id] + accumulated_prob, last_read_id) / read_set_->size();
+  for (int read_id: deltas->touched()) {
+    double read_log_prob = GetRealReadProbability(
+        read_probs_[read_id] + (*deltas)[read_id], read_id);
+    new_prob -= read_log_probs_[read_id] / read_set_->size();
+    new_prob += read_log_prob / read_set_->size();
     if (write) {
-      read_probs_[last_read_id] += accumulated_prob;
+      read_probs_[read_id] += (*deltas)[read_id];
+      read_log_probs_[read_id] = read_log_prob;
     }
   }
+  ReleaseDeltas(move(deltas));
   if (write) total_log_prob_ = new_prob;
   return new_prob;
 }
 
-double SingleReadProbabilityCalculator::GetAlignmentProb(
+unique_ptr<DeltaAccumulator<double>> SingleReadProbabilityCalculator::AcquireDeltas() {
+  unique_ptr<DeltaAccumulator<double>> deltas;
+  {
+    lock_guard<mutex> lock(delta_pool_->free_mutex);
+    if (!delta_pool_->free.empty()) {
+      deltas = move(delta_pool_->free.back());
+      delta_pool_->free.pop_back();
+    }
+  }
+  if (!deltas) {
+    deltas.reset(new DeltaAccumulator<double>(read_set_->size()));
+  }
+  deltas->Clear();
+  return deltas;
+}
+
+void SingleReadProbabilityCalculator::ReleaseDeltas(
+    unique_ptr<DeltaAccumulator<double>> deltas) {
+  lock_guard<mutex> lock(delta_pool_->free_mutex);
+  delta_pool_->free.push_back(move(deltas));
+}
+
+double SingleReadProbabilityCalculator::ComputeAlignmentProb(
     int dist, int read_length) const {
+  if (log_space_) {
+    return pow(mismatch_prob_ / (1 - mismatch_prob_), dist);
+  }
   return pow(mismatch_prob_, dist) * pow(1 - mismatch_prob_, read_length - dist);
 }
 
+void SingleReadProbabilityCalculator::InitProbabilityTables() {
+  int max_length = read_set_->max_read_length();
+  int dists = ReadSet<>::kMaxErrors + 1;
+  alignment_probs_.resize((max_length + 1) * dists);
+  log_scales_.resize(max_length + 1);
+  min_log_probs_.resize(max_length + 1);
+  for (int length = 0; length <= max_length; length++) {
+    for (int dist = 0; dist < dists; dist++) {
+      alignment_probs_[length * dists + dist] = ComputeAlignmentProb(dist, length);
+    }
+    log_scales_[length] = log_space_ ? length * log(1 - mismatch_prob_) : 0;
+    min_log_probs_[length] = min_prob_start_ + length * min_prob_per_base_;
+  }
+}
+
 void SingleReadProbabilityCalculator::ApplyProbabilityChange(
     const ProbabilityChange& prob_change) {
   EvalTotalProbabilityFromChange(prob_change, true);
@@ -94,50 +128,88 @@ double SingleReadProbabilityCalculator::InitTotalLogProb() {
   double ret = 0;
   for (size_t i = 0; i < read_set_->size(); i++) {
     read_probs_[i] = 0;
-    ret += GetMinLogProbability((*read_set_)[i].size()) / read_set_->size();
+    read_log_probs_[i] = GetMinLogProbability(read_set_->read_length(i));
+    ret += read_log_probs_[i] / read_set_->size();
   }
   return ret;
 }
 
 double SingleReadProbabilityCalculator::GetMinLogProbability(int read_length) const {
-  return min_prob_start_ + read_length * min_prob_per_base_; 
+  return min_log_probs_[read_length];
 }
 
 double SingleReadProbabilityCalculator::GetRealReadProbability(double prob, int read_id) const {
-  return max(log(max(0.0, prob)), GetMinLogProbability((*read_set_)[read_id].size()));
+  int read_length = read_set_->read_length(read_id);
+  return max(log_scales_[read_length] + log(max(0.0, prob)), min_log_probs_[read_length]);
+}
+
+int SingleReadProbabilityCalculator::GetPathsLength(const PathSet& paths) const {
+  int ret = 0;
+  for (size_t i = 0; i < paths.size(); i++) {
+    ret += paths[i].Length(true);
+  }
+  return ret;
 }
 
 int SingleReadProbabilityCalculator::GetPathsLength(const vector<Path>& paths) const {
   int ret = 0;
   for (auto &p: paths) {
-    ret += p.ToString(true).size();
+    ret += p.Length(true);
   }
   return ret;
 }
 
 GlobalProbabilityCalculator::GlobalProbabilityCalculator(const Config& config) {
-  for (auto &single_short_reads: config.single_short_reads()) {
+  thread_pool_ = NULL;
+  if (config.num_threads() > 1) {
+    thread_pool_ = new ThreadPool(config.num_threads());
+  }
+  for (int i = 0; i < config.single_short_reads_size(); i++) {
     ReadSet<>* rs = new ReadSet<>();
-    rs->LoadReadSet(single_short_reads.filename());
+    rs->SetThreadPool(thread_pool_);
+    if (config.verification_engine() == Config::MYERS) {
+      rs->SetVerificationEngine(VERIFY_MYERS);
+    } else if (config.verification_engine() == Config::BATCHED) {
+      rs->SetVerificationEngine(VERIFY_BATCHED);
+    }
     read_sets_.push_back(rs);
+  }
+  // Read sets are independent, so they are loaded concurrently (read ids
+  // do not depend on it).
+  ParallelFor(thread_pool_, read_sets_.size(), [&](int i) {
+    auto &single_short_reads = config.single_short_reads(i);
+    read_sets_[i]->LoadReadSet(single_short_reads.filename(),
+                               single_short_reads.index_cache());
+  });
+  for (int i = 0; i < config.single_short_reads_size(); i++) {
+    auto &single_short_reads = config.single_short_reads(i);
     single_read_calculators_.push_back(make_pair(SingleReadProbabilityCalculator(
-          rs, single_short_reads.mismatch_prob(),
+          read_sets_[i], single_short_reads.mismatch_prob(),
           single_short_reads.min_prob_start(),
           single_short_reads.min_prob_per_base(),
           single_short_reads.penalty_constant(),
-          single_short_reads.penalty_step()), single_short_reads.weight()));
+          single_short_reads.penalty_step(),
+          (size_t) config.alignment_cache_mb() << 20,
+          config.incremental_alignment(), single_short_reads.log_space()),
+          single_short_reads.weight()));
   }
 }
 
 double GlobalProbabilityCalculator::GetPathsProbability(
-    const vector<Path>& paths, ProbabilityChanges& prob_changes) {
+    const PathSet& paths, ProbabilityChanges& prob_changes) {
+  // Read sets are evaluated concurrently, but summed in fixed order, so the
+  // total does not depend on scheduling.
+  int n = single_read_calculators_.size();
   prob_changes.single_read_changes.clear();
+  prob_changes.single_read_changes.resize(n);
+  vector<double> probs(n);
+  ParallelFor(thread_pool_, n, [&](int i) {
+    probs[i] = single_read_calculators_[i].first.GetPathsProbability(
+        paths, prob_changes.single_read_changes[i]);
+  });
   double total_prob = 0;
-  for (auto &single_read_calculator: single_read_calculators_) {
-    ProbabilityChange ch;
-    double prob = single_read_calculator.first.GetPathsProbability(paths, ch);
-    total_prob += prob * single_read_calculator.second;
-    prob_changes.single_read_changes.push_back(ch);
+  for (int i = 0; i < n; i++) {
+    total_prob += probs[i] * single_read_calculators_[i].second;
   }
   return total_prob;
 }
@@ -145,7 +217,8 @@ double GlobalProbabilityCalculator::GetPathsProbability(
 void GlobalProbabilityCalculator::ApplyProbabilityChanges(
     const ProbabilityChanges& prob_changes) {
   assert(prob_changes.single_read_changes.size() == single_read_calculators_.size());
-  for (size_t i = 0; i < single_read_calculators_.size(); i++) {
-    single_read_calculators_[i].first.ApplyProbabilityChange(prob_changes.single_read_changes[i]);
-  }
+  ParallelFor(thread_pool_, single_read_calculators_.size(), [&](int i) {
+    single_read_calculators_[i].first.ApplyProbabilityChange(
+        prob_changes.single_read_changes[i]);
+  });
 }
@@ -2,7 +2,11 @@
 #define READ_PROBABILITY_CALCULATOR_H__
 
 #include "path_aligner.h"
+#include "path_set.h"
+#include "delta_accumulator.h"
 #include "config.pb.h"
+#include <memory>
+#include <mutex>
 
 struct ProbabilityChange {
   vector<Path> added_paths;
@@ -13,31 +17,41 @@ struct ProbabilityChange {
 
   int new_paths_length;
 
-  vector<Path> new_paths;
+  PathSet new_paths;
 };
 
 struct ProbabilityChanges {
   vector<ProbabilityChange> single_read_changes;
 };
 
+// Copies share the read set and the alignment cache, but have their own
+// probability state, so each annealing chain can use its own copy.
 class SingleReadProbabilityCalculator {
  public:
   SingleReadProbabilityCalculator(
       ReadSet<>* read_set, double mismatch_prob,
       double min_prob_start, double min_prob_per_base,
-      double penalty_constant, int penalty_step) :
-        read_set_(read_set), path_aligner_(read_set),
+      double penalty_constant, int penalty_step,
+      size_t alignment_cache_bytes = PathAligner::kDefaultCacheBytes,
+      bool incremental_alignment = false, bool log_space = false) :
+        read_set_(read_set),
+        path_aligner_(new PathAligner(read_set, alignment_cache_bytes,
+                                      incremental_alignment)),
         mismatch_prob_(mismatch_prob),
         min_prob_start_(min_prob_start), min_prob_per_base_(min_prob_per_base),
         penalty_constant_(penalty_constant), penalty_step_(penalty_step),
+        log_space_(log_space), delta_pool_(new DeltaPool),
         old_paths_length_(1) {
+    InitProbabilityTables();
     read_probs_.resize(read_set_->size());
+    read_log_probs_.resize(read_set_->size());
     total_log_prob_ = InitTotalLogProb();
   }
 
-  // Call this first
+  // Call this first. Does not change the state, so several proposals can
+  // be evaluated concurrently.
   double GetPathsProbability(
-      const vector<Path>& paths, ProbabilityChange& prob_change);
+      const PathSet& paths, ProbabilityChange& prob_change);
 
   // Call this after you are happy with current result (i.e. you got better
   // probability)
@@ -46,9 +60,13 @@ class SingleReadProbabilityCalculator {
  private:
   double InitTotalLogProb();
 
+  // Fills alignment_probs_, log_scales_ and min_log_probs_
+  void InitProbabilityTables();
+
   double GetMinLogProbability(int read_length) const;
 
-  // max(min_prob, prob)
+  // max(min_prob, prob), prob is sum of alignment probabilities (scaled in
+  // log space mode)
   double GetRealReadProbability(double prob, int read_id) const;
 
   // Evals change with filled added and removed paths
@@ -57,37 +75,73 @@ class SingleReadProbabilityCalculator {
   // Get total probability from change and cached data
   double EvalTotalProbabilityFromChange(const ProbabilityChange& prob_change, bool write=false);
 
+  int GetPathsLength(const PathSet& paths) const;
   int GetPathsLength(const vector<Path>& paths) const;
 
-  double GetAlignmentProb(int dist, int read_length) const;
+  // Probability of alignment, divided by (1 - mismatch_prob)^read_length
+  // in log space mode
+  double GetAlignmentProb(int dist, int read_length) const {
+    if (dist <= ReadSet<>::kMaxErrors && read_length <= read_set_->max_read_length()) {
+      return alignment_probs_[read_length * (ReadSet<>::kMaxErrors + 1) + dist];
+    }
+    return ComputeAlignmentProb(dist, read_length);
+  }
+
+  double ComputeAlignmentProb(int dist, int read_length) const;
 
   ReadSet<>* read_set_;
-  PathAligner path_aligner_;
+  // Shared by copies of the calculator
+  shared_ptr<PathAligner> path_aligner_;
   double mismatch_prob_;
   double min_prob_start_;
   double min_prob_per_base_;
   double penalty_constant_;
   int penalty_step_;
+  // Per read sums are kept relative to probability of alignment without
+  // errors, so they do not underflow for long reads.
+  bool log_space_;
+
+  // Indexed by read_length * (kMaxErrors + 1) + dist
+  vector<double> alignment_probs_;
+  // Added to log of per read sums, indexed by read length
+  vector<double> log_scales_;
+  vector<double> min_log_probs_;
 
   vector<double> read_probs_;
+  // GetRealReadProbability of read_probs_
+  vector<double> read_log_probs_;
+  // Accumulators for changes of read_probs_ in evaluated proposals, one is
+  // taken for each evaluation.
+  struct DeltaPool {
+    mutex free_mutex;
+    vector<unique_ptr<DeltaAccumulator<double>>> free;
+  };
+  unique_ptr<DeltaAccumulator<double>> AcquireDeltas();
+  void ReleaseDeltas(unique_ptr<DeltaAccumulator<double>> deltas);
+  // Scratch only, so it can be shared by copies
+  shared_ptr<DeltaPool> delta_pool_;
   double total_log_prob_;
   int old_paths_length_;
-  vector<Path> old_paths_;
+  PathSet old_paths_;
 };
 
+// Copies share read sets, thread pool and alignment caches (see
+// SingleReadProbabilityCalculator).
 class GlobalProbabilityCalculator {
  public:
   GlobalProbabilityCalculator(const Config &config);
 
-  // Call this first
+  // Call this first. Safe to call concurrently (but not together with
+  // ApplyProbabilityChanges).
   double GetPathsProbability(
-      const vector<Path>& paths, ProbabilityChanges& prob_changes);
+      const PathSet& paths, ProbabilityChanges& prob_changes);
 
   // Call this after you are happy with current result (i.e. you got better
   // probability)
   void ApplyProbabilityChanges(const ProbabilityChanges& prob_changes);
 
  private:
+  ThreadPool* thread_pool_;
   vector<ReadSet<>*> read_sets_;
   // (prob calculator, weight)
   vector<pair<SingleReadProbabilityCalculator, double>> single_read_calculators_;
@@ -2,6 +2,7 @@
 #include "graph.h"
 #include "util.h"
 #include <gtest/gtest.h>
+#include <cmath>
 #include <sstream>
 #include <tuple>
 
@@ -252,3 +253,123 @@ TEST(SingleReadProbabilityCalculator, Test7) {
   double pr2 = rp.GetPathsProbability(vector<Path>({p1}), prob_change);
   EXPECT_FLOAT_EQ(-5.5901132, pr2);
 }
+
+TEST(SingleReadProbabilityCalculatorTest, LogSpaceTest) {
+  stringstream ss;
+  ss << "2\t1000\t41\t1\n";
+  ss << "NODE\t1\t121\t0\t0\n";
+  ss << "GTCAGCTTTTGGTGCTTGAGCATCATTTAGCTTTTTAGCTTCTGCTAAAAGGTTAGCGCTTTGGCTTGGGTCATCTTTTAGGCTTTGGATGAAACCATTGCGTTGTTCTTCGTTTAAGTTA\n";
+  ss << "CTAAAAGATGACCCAAGCCAAAGCGCTAACCTTTTAGCAGAAGCTAAAAAGCTAAATGATGCTCAAGCACCAAAAGCTGACAACAAATTCAACAAAGAACAACAAAATGCTTTCTATGAAA\n";
+  ss << "NODE\t2\t4\t0\t0\n";
+  ss << "AGAC\n";
+  ss << "TGCC\n";
+  ss << "ARC\t1\t-2\t44\n";
+  Graph *g = LoadGraph(ss);
+
+  Path p1({g->nodes_[0]});
+
+  stringstream ss2;
+  ss2 << "@a" << endl;
+  ss2 << "GTCAGCTTTTGGTGCTTGAGCATCATTTAGCTTTTTAGCTTCTGCTAAAAGGTTAGCGCTTTGGCTTGGGTCATCTTTTAGGCTTTGGATGAAACCATTGCGTTGTTCTTCGTTTAAGTTA" << endl;
+  ss2 << "+" << endl;
+  ss2 << "GTCAGCTTTTGGTGCTTGAGCATCATTTAGCTTTTTAGCTTCTGCTAAAAGGTTAGCGCTTTGGCTTGGGTCATCTTTTAGGCTTTGGATGAAACCATTGCGTTGTTCTTCGTTTAAGTTA" << endl;
+
+  ReadSet<> rs;
+  rs.LoadReadSet(ss2);
+
+  SingleReadProbabilityCalculator rp(&rs, 0.01, -10, -0.7, 0, 0,
+                                     PathAligner::kDefaultCacheBytes, false, true);
+  ProbabilityChange prob_change;
+  double pr1 = rp.GetPathsProbability(vector<Path>({p1}), prob_change);
+  EXPECT_FLOAT_EQ(-6.29749500325813737913, pr1);
+}
+
+TEST(SingleReadProbabilityCalculatorTest, LongReadLogSpaceTest) {
+  // Probability of error free alignment of the read is below the smallest
+  // double.
+  srand(47);
+  char alph[] = "ACGT";
+  string read;
+  for (int i = 0; i < 2100; i++) {
+    read += alph[rand()%4];
+  }
+  stringstream ss;
+  ss << "1\t1000\t41\t1\n";
+  ss << "NODE\t1\t" << read.size() << "\t0\t0\n";
+  ss << read << endl;
+  ss << ReverseSeq(read) << endl;
+  Graph *g = LoadGraph(ss);
+  Path p1({g->nodes_[0]});
+
+  stringstream ss2;
+  ss2 << "@a" << endl << read << endl << "+" << endl << read << endl;
+  ReadSet<> rs;
+  rs.LoadReadSet(ss2);
+  rs.SetVerificationEngine(VERIFY_MYERS);
+
+  ProbabilityChange prob_change;
+  SingleReadProbabilityCalculator linear(&rs, 0.3, -10, -0.7, 0, 0);
+  double linear_prob = linear.GetPathsProbability(vector<Path>({p1}), prob_change);
+  SingleReadProbabilityCalculator log_space(&rs, 0.3, -10, -0.7, 0, 0,
+                                            PathAligner::kDefaultCacheBytes,
+                                            false, true);
+  double log_space_prob = log_space.GetPathsProbability(vector<Path>({p1}), prob_change);
+  // Linear sum underflows to zero and read gets the minimal probability.
+  EXPECT_NEAR(2100 * log(0.7) - (-10 - 0.7 * 2100), log_space_prob - linear_prob, 1e-6);
+}
+
+TEST(SingleReadProbabilityCalculatorTest, ConcurrentProposalsTest) {
+  string part1 = "";
+  char alph[] = "ACGT";
+  for (int i = 0; i < 50; i++) {
+    part1 += alph[rand()%4];
+  }
+  stringstream ss;
+  ss << "2\t1000\t41\t1\n";
+  ss << "NODE\t1\t180\t0\t0\n";
+  ss << part1 + string(40, 'C') + part1 + string(40, 'A') << endl;
+  ss << ReverseSeq(part1) + string(40, 'G') + ReverseSeq(part1) + string(40, 'A') << endl;
+  ss << "NODE\t2\t4\t0\t0\n";
+  ss << "AGAC\n";
+  ss << "TGCC\n";
+  ss << "ARC\t1\t2\t44\n";
+
+  Graph *g = LoadGraph(ss);
+
+  stringstream ss2;
+  for (int i = 0; i < 20; i++) {
+    ss2 << "@a" << i << endl;
+    ss2 << part1.substr(i, 30) << endl;
+    ss2 << "+" << endl;
+    ss2 << part1.substr(i, 30) << endl;
+  }
+
+  ReadSet<> rs;
+  rs.LoadReadSet(ss2);
+
+  SingleReadProbabilityCalculator rp(&rs, 0.01, -10, -0.7, 0, 0);
+  ProbabilityChange start_change;
+  rp.GetPathsProbability(vector<Path>({Path({g->nodes_[0]})}), start_change);
+  rp.ApplyProbabilityChange(start_change);
+
+  vector<vector<Path>> proposals({
+      {Path({g->nodes_[0]})},
+      {Path({g->nodes_[0], g->nodes_[2]})},
+      {Path({g->nodes_[1]})},
+      {Path({g->nodes_[0]}), Path({g->nodes_[1]})}});
+  vector<double> expected;
+  for (auto &paths: proposals) {
+    ProbabilityChange prob_change;
+    expected.push_back(rp.GetPathsProbability(paths, prob_change));
+  }
+
+  ThreadPool pool(4);
+  vector<double> probs(proposals.size() * 8);
+  pool.ParallelFor(probs.size(), [&](int i) {
+    ProbabilityChange prob_change;
+    probs[i] = rp.GetPathsProbability(proposals[i % proposals.size()], prob_change);
+  });
+  for (size_t i = 0; i < probs.size(); i++) {
+    EXPECT_DOUBLE_EQ(expected[i % proposals.size()], probs[i]);
+  }
+}
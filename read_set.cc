@@ -2,24 +2,49 @@
 #include "hash_util.h"
 #include "util.h"
 #include <algorithm>
+#include <cstring>
 #include <deque>
 #include <unordered_set>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-void StandardReadIndex::AddRead(int id, const string& data) {
-  for (size_t i = 0; i + k_ <= data.size(); i++) {
-    index_[data.substr(i, k_)].push_back(make_pair(id, i));
+namespace {
+
+// Calls f(base) for every base of s in order
+template<class F>
+void ForEachBase(const string& s, F f) {
+  for (char c: s) {
+    f(c);
   }
 }
 
-vector<CandidateReadPosition> StandardReadIndex::GetReadCandidates(const string& genome) const {
+template<class F>
+void ForEachBase(const SequenceView& s, F f) {
+  s.ForEach(f);
+}
+
+template<class F>
+void ForEachBase(const PackedRead& s, F f) {
+  for (int i = 0; i < (int) s.size(); i++) {
+    f(s[i]);
+  }
+}
+
+// Candidates from index keyed by k-mer strings. TSeq is string or
+// SequenceView.
+template<class TSeq>
+vector<CandidateReadPosition> GetStringKmerCandidates(
+    const TSeq& genome, int k, const unordered_map<string, vector<pair<int,int>>>& index) {
   //read_id, diagonal / 5
-  static unordered_set<pair<int, int>> found_cands;
+  static thread_local unordered_set<pair<int, int>> found_cands;
   found_cands.clear();
   vector<CandidateReadPosition> ret;
 
-  for (size_t i = 0; i + k_ <= genome.size(); i++) {
-    auto it = index_.find(genome.substr(i, k_));
-    if (it == index_.end()) continue;
+  for (int i = 0; i + k <= (int) genome.size(); i++) {
+    auto it = index.find(genome.substr(i, k));
+    if (it == index.end()) continue;
     for (auto &e: it->second) {
       int coord = (i - e.second) / 5;
       if (found_cands.count(make_pair(e.first, coord))) {
@@ -32,6 +57,23 @@ vector<CandidateReadPosition> StandardReadIndex::GetReadCandidates(const string&
   return ret;
 }
 
+}
+
+void StandardReadIndex::AddRead(int id, const string& data) {
+  for (size_t i = 0; i + k_ <= data.size(); i++) {
+    index_[data.substr(i, k_)].push_back(make_pair(id, i));
+  }
+}
+
+vector<CandidateReadPosition> StandardReadIndex::GetReadCandidates(const string& genome) const {
+  return GetStringKmerCandidates(genome, k_, index_);
+}
+
+vector<CandidateReadPosition> StandardReadIndex::GetReadCandidates(
+    const SequenceView& genome) const {
+  return GetStringKmerCandidates(genome, k_, index_);
+}
+
 void RandomIndex::AddRead(int id, const string& data) {
   if ((int) data.size() < k_) return;
   for (int i = 0; i < 3; i++) {
@@ -41,14 +83,64 @@ void RandomIndex::AddRead(int id, const string& data) {
 }
 
 vector<CandidateReadPosition> RandomIndex::GetReadCandidates(const string& genome) const {
+  return GetStringKmerCandidates(genome, k_, index_);
+}
+
+vector<CandidateReadPosition> RandomIndex::GetReadCandidates(const SequenceView& genome) const {
+  return GetStringKmerCandidates(genome, k_, index_);
+}
+
+namespace {
+
+// Calls f(pos, kmer) for every k-mer of s without other bases than ACGT,
+// k-mer is packed 2 bits per base, first base in the highest bits. TSeq is
+// string, SequenceView or PackedRead.
+template<class TSeq, class F>
+void ForEachPackedKmer(const TSeq& s, int k, F f) {
+  uint64_t mask = k >= 32 ? ~0ULL : (1ULL << (2 * k)) - 1;
+  uint64_t kmer = 0;
+  int valid = 0;
+  int i = 0;
+  ForEachBase(s, [&](char c) {
+    int bits = BaseToBits(c);
+    i++;
+    if (bits < 0) {
+      valid = 0;
+      kmer = 0;
+      return;
+    }
+    kmer = ((kmer << 2) | bits) & mask;
+    valid++;
+    if (valid >= k) {
+      f(i - k, kmer);
+    }
+  });
+}
+
+// Returns false if k-mer contains other bases than ACGT
+template<class TSeq>
+bool PackKmer(const TSeq& s, int start, int k, uint64_t& kmer) {
+  kmer = 0;
+  for (int i = start; i < start + k; i++) {
+    int bits = BaseToBits(s[i]);
+    if (bits < 0) return false;
+    kmer = (kmer << 2) | bits;
+  }
+  return true;
+}
+
+template<class TSeq>
+vector<CandidateReadPosition> GetPackedReadCandidates(
+    const TSeq& genome, int k,
+    const unordered_map<uint64_t, vector<pair<int,int>>>& index) {
   //read_id, diagonal / 5
-  static unordered_set<pair<int, int>> found_cands;
+  static thread_local unordered_set<pair<int, int>> found_cands;
   found_cands.clear();
   vector<CandidateReadPosition> ret;
 
-  for (size_t i = 0; i + k_ <= genome.size(); i++) {
-    auto it = index_.find(genome.substr(i, k_));
-    if (it == index_.end()) continue;
+  ForEachPackedKmer(genome, k, [&](int i, uint64_t kmer) {
+    auto it = index.find(kmer);
+    if (it == index.end()) return;
     for (auto &e: it->second) {
       int coord = (i - e.second) / 5;
       if (found_cands.count(make_pair(e.first, coord))) {
@@ -57,20 +149,398 @@ vector<CandidateReadPosition> RandomIndex::GetReadCandidates(const string& genom
       found_cands.insert(make_pair(e.first, coord));
       ret.push_back(CandidateReadPosition(e.first, i, e.second));
     }
+  });
+  return ret;
+}
+
+}
+
+void PackedStandardReadIndex::AddRead(int id, const string& data) {
+  ForEachPackedKmer(data, k_, [&](int i, uint64_t kmer) {
+    index_[kmer].push_back(make_pair(id, i));
+  });
+}
+
+vector<CandidateReadPosition> PackedStandardReadIndex::GetReadCandidates(
+    const string& genome) const {
+  return GetPackedReadCandidates(genome, k_, index_);
+}
+
+vector<CandidateReadPosition> PackedStandardReadIndex::GetReadCandidates(
+    const SequenceView& genome) const {
+  return GetPackedReadCandidates(genome, k_, index_);
+}
+
+void PackedRandomIndex::AddRead(int id, const string& data) {
+  if ((int) data.size() < k_) return;
+  for (int i = 0; i < 3; i++) {
+    int p = rand()%(data.size() - k_ + 1);
+    uint64_t kmer;
+    if (PackKmer(data, p, k_, kmer)) {
+      index_[kmer].push_back(make_pair(id, p));
+    }
   }
+}
+
+vector<CandidateReadPosition> PackedRandomIndex::GetReadCandidates(
+    const string& genome) const {
+  return GetPackedReadCandidates(genome, k_, index_);
+}
+
+vector<CandidateReadPosition> PackedRandomIndex::GetReadCandidates(
+    const SequenceView& genome) const {
+  return GetPackedReadCandidates(genome, k_, index_);
+}
+
+CompactReadIndex::~CompactReadIndex() {
+  Unmap();
+}
+
+void CompactReadIndex::Unmap() {
+  if (mapped_ != NULL) {
+    munmap(mapped_, mapped_size_);
+    mapped_ = NULL;
+    mapped_size_ = 0;
+  }
+}
+
+namespace {
+
+// Random generator seeded by read id (splitmix64), so sampled k-mers do not
+// depend on the order in which reads are indexed.
+uint64_t NextSample(uint64_t& state) {
+  uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+template<class TSeq>
+void CollectCompactKmers(const TSeq& data, int id, int k, int sampled_kmers,
+                         vector<pair<uint64_t, uint64_t>>& output) {
+  if (sampled_kmers == 0) {
+    ForEachPackedKmer(data, k, [&](int i, uint64_t kmer) {
+      output.push_back(make_pair(kmer, ((uint64_t) id << 32) | i));
+    });
+    return;
+  }
+  if ((int) data.size() < k) return;
+  uint64_t state = id;
+  for (int i = 0; i < sampled_kmers; i++) {
+    int p = NextSample(state) % (data.size() - k + 1);
+    uint64_t kmer;
+    if (PackKmer(data, p, k, kmer)) {
+      output.push_back(make_pair(kmer, ((uint64_t) id << 32) | p));
+    }
+  }
+}
+
+}
+
+void CompactReadIndex::AddRead(int id, const string& data) {
+  CollectCompactKmers(data, id, k_, sampled_kmers_, pending_);
+}
+
+void CompactReadIndex::Finalize() {
+  Unmap();
+  sort(pending_.begin(), pending_.end());
+  vector<vector<pair<uint64_t, uint64_t>>> shards(1);
+  shards[0].swap(pending_);
+  BuildFromShards(shards, NULL);
+}
+
+void CompactReadIndex::Build(const PackedReadStore& reads, ThreadPool* thread_pool) {
+  Unmap();
+  int num_chunks = 1;
+  if (thread_pool != NULL) {
+    num_chunks = max(1, min(4 * thread_pool->num_threads(), (int) reads.size() / 1024));
+  }
+  // Shards are ranges of k-mers given by their top bits
+  const int shard_bits = 6;
+  const int num_shards = 1 << shard_bits;
+  int shift = max(0, 2 * k_ - shard_bits);
+
+  // Every chunk of reads splits its k-mers into shards...
+  vector<vector<vector<pair<uint64_t, uint64_t>>>> chunk_shards(num_chunks);
+  ParallelFor(thread_pool, num_chunks, [&](int chunk) {
+    size_t begin = reads.size() * chunk / num_chunks;
+    size_t end = reads.size() * (chunk + 1) / num_chunks;
+    vector<pair<uint64_t, uint64_t>> kmers;
+    auto& shards = chunk_shards[chunk];
+    shards.resize(num_shards);
+    for (size_t i = begin; i < end; i++) {
+      kmers.clear();
+      CollectCompactKmers(reads[i], i, k_, sampled_kmers_, kmers);
+      for (auto& kmer: kmers) {
+        shards[kmer.first >> shift].push_back(kmer);
+      }
+    }
+  });
+
+  // ...and each shard is merged and sorted separately.
+  vector<vector<pair<uint64_t, uint64_t>>> shards(num_shards);
+  ParallelFor(thread_pool, num_shards, [&](int shard) {
+    size_t total = 0;
+    for (auto& c: chunk_shards) {
+      total += c[shard].size();
+    }
+    shards[shard].reserve(total);
+    for (auto& c: chunk_shards) {
+      shards[shard].insert(shards[shard].end(), c[shard].begin(), c[shard].end());
+      vector<pair<uint64_t, uint64_t>>().swap(c[shard]);
+    }
+    sort(shards[shard].begin(), shards[shard].end());
+  });
+  BuildFromShards(shards, thread_pool);
+}
+
+void CompactReadIndex::BuildFromShards(
+    vector<vector<pair<uint64_t, uint64_t>>>& shards, ThreadPool* thread_pool) {
+  int num_shards = shards.size();
+  vector<size_t> key_starts(num_shards + 1, 0), posting_starts(num_shards + 1, 0);
+  ParallelFor(thread_pool, num_shards, [&](int shard) {
+    auto& entries = shards[shard];
+    size_t keys = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+      if (i == 0 || entries[i].first != entries[i-1].first) keys++;
+    }
+    key_starts[shard + 1] = keys;
+    posting_starts[shard + 1] = entries.size();
+  });
+  for (int shard = 0; shard < num_shards; shard++) {
+    key_starts[shard + 1] += key_starts[shard];
+    posting_starts[shard + 1] += posting_starts[shard];
+  }
+
+  keys_storage_.resize(key_starts[num_shards]);
+  offsets_storage_.resize(key_starts[num_shards] + 1);
+  postings_storage_.resize(posting_starts[num_shards]);
+  ParallelFor(thread_pool, num_shards, [&](int shard) {
+    auto& entries = shards[shard];
+    size_t key = key_starts[shard];
+    size_t posting = posting_starts[shard];
+    for (size_t i = 0; i < entries.size(); i++, posting++) {
+      if (i == 0 || entries[i].first != entries[i-1].first) {
+        keys_storage_[key] = entries[i].first;
+        offsets_storage_[key] = posting;
+        key++;
+      }
+      postings_storage_[posting] = entries[i].second;
+    }
+    vector<pair<uint64_t, uint64_t>>().swap(entries);
+  });
+  offsets_storage_[key_starts[num_shards]] = posting_starts[num_shards];
+
+  keys_ = keys_storage_.data();
+  offsets_ = offsets_storage_.data();
+  postings_ = postings_storage_.data();
+  num_keys_ = keys_storage_.size();
+}
+
+vector<CandidateReadPosition> CompactReadIndex::GetReadCandidates(
+    const string& genome) const {
+  return GetCandidates(genome);
+}
+
+vector<CandidateReadPosition> CompactReadIndex::GetReadCandidates(
+    const SequenceView& genome) const {
+  return GetCandidates(genome);
+}
+
+template<class TSeq>
+vector<CandidateReadPosition> CompactReadIndex::GetCandidates(const TSeq& genome) const {
+  //read_id, diagonal / 5
+  static thread_local unordered_set<pair<int, int>> found_cands;
+  found_cands.clear();
+  vector<CandidateReadPosition> ret;
+  if (num_keys_ == 0) return ret;
+
+  ForEachPackedKmer(genome, k_, [&](int i, uint64_t kmer) {
+    const uint64_t* it = lower_bound(keys_, keys_ + num_keys_, kmer);
+    if (it == keys_ + num_keys_ || *it != kmer) return;
+    size_t key_id = it - keys_;
+    for (uint64_t j = offsets_[key_id]; j < offsets_[key_id+1]; j++) {
+      int read_id = postings_[j] >> 32;
+      int read_pos = postings_[j] & 0xFFFFFFFFULL;
+      int coord = (i - read_pos) / 5;
+      if (found_cands.count(make_pair(read_id, coord))) {
+        continue;
+      }
+      found_cands.insert(make_pair(read_id, coord));
+      ret.push_back(CandidateReadPosition(read_id, i, read_pos));
+    }
+  });
   return ret;
 }
 
+namespace {
+
+// Layout of saved CompactReadIndex: header, keys (num_keys),
+// offsets (num_keys + 1), postings (num_postings), all 64-bit.
+struct CompactIndexHeader {
+  char magic[8];
+  uint64_t k;
+  uint64_t sampled_kmers;
+  uint64_t fingerprint;
+  uint64_t num_keys;
+  uint64_t num_postings;
+};
+
+const char kCompactIndexMagic[8] = {'G', 'A', 'M', 'L', 'I', 'D', 'X', '1'};
+
+}
+
+bool CompactReadIndex::Save(const string& filename, uint64_t fingerprint) const {
+  CompactIndexHeader header;
+  memcpy(header.magic, kCompactIndexMagic, sizeof(header.magic));
+  header.k = k_;
+  header.sampled_kmers = sampled_kmers_;
+  header.fingerprint = fingerprint;
+  header.num_keys = num_keys_;
+  header.num_postings = num_postings();
+
+  ofstream of(filename, ios::binary);
+  if (!of) return false;
+  of.write((const char*) &header, sizeof(header));
+  if (num_keys_ > 0) {
+    of.write((const char*) keys_, num_keys_ * sizeof(uint64_t));
+    of.write((const char*) offsets_, (num_keys_ + 1) * sizeof(uint64_t));
+    of.write((const char*) postings_, header.num_postings * sizeof(uint64_t));
+  }
+  return (bool) of;
+}
+
+bool CompactReadIndex::Load(const string& filename, uint64_t fingerprint) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(CompactIndexHeader)) {
+    close(fd);
+    return false;
+  }
+  void* mapped = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) return false;
+
+  const CompactIndexHeader* header = (const CompactIndexHeader*) mapped;
+  size_t size = st.st_size;
+  // Counts are bounded by size first, so the sum below cannot overflow
+  bool valid = header->num_keys <= size / sizeof(uint64_t) &&
+      header->num_postings <= size / sizeof(uint64_t);
+  size_t expected_size = sizeof(CompactIndexHeader);
+  if (valid && header->num_keys > 0) {
+    expected_size += (2 * header->num_keys + 1 + header->num_postings) * sizeof(uint64_t);
+  }
+  valid = valid && memcmp(header->magic, kCompactIndexMagic, sizeof(header->magic)) == 0 &&
+      header->k == (uint64_t) k_ && header->sampled_kmers == (uint64_t) sampled_kmers_ &&
+      header->fingerprint == fingerprint && size == expected_size;
+  if (valid && header->num_keys > 0) {
+    // Lookups rely on sorted keys and read postings between offsets
+    const uint64_t* keys = (const uint64_t*) (header + 1);
+    const uint64_t* offsets = keys + header->num_keys;
+    valid = offsets[0] == 0 && offsets[header->num_keys] == header->num_postings;
+    for (uint64_t i = 0; valid && i < header->num_keys; i++) {
+      valid = offsets[i] <= offsets[i+1] && (i == 0 || keys[i-1] < keys[i]);
+    }
+  }
+  if (!valid) {
+    munmap(mapped, st.st_size);
+    return false;
+  }
+
+  Unmap();
+  pending_.clear();
+  keys_storage_.clear();
+  offsets_storage_.clear();
+  postings_storage_.clear();
+  mapped_ = mapped;
+  mapped_size_ = st.st_size;
+  num_keys_ = header->num_keys;
+  keys_ = (const uint64_t*) (header + 1);
+  offsets_ = keys_ + num_keys_;
+  postings_ = offsets_ + num_keys_ + 1;
+  return true;
+}
+
+namespace {
+
+// Splits sorted candidates into num_chunks ranges which do not split
+// candidates of one read. Returns starts of the ranges followed by
+// candidates.size(); some ranges may be empty.
+vector<int> SplitAtReadBoundaries(const vector<CandidateReadPosition>& candidates,
+                                  int num_chunks) {
+  vector<int> chunk_starts;
+  chunk_starts.push_back(0);
+  for (int i = 1; i < num_chunks; i++) {
+    int start = max(chunk_starts.back(), (int) (candidates.size() * i / num_chunks));
+    while (start > 0 && start < (int) candidates.size() &&
+           candidates[start].read_id == candidates[start-1].read_id) {
+      start++;
+    }
+    chunk_starts.push_back(start);
+  }
+  chunk_starts.push_back(candidates.size());
+  return chunk_starts;
+}
+
+// Indexes are built incrementally by AddRead and cannot be cached, except
+// for CompactReadIndex, which is also built in parallel.
+template<class TIndex>
+void FinalizeIndex(TIndex& index) {}
+
+template<class TIndex>
+void BuildIndex(TIndex& index, const PackedReadStore& reads, ThreadPool* thread_pool) {
+  for (size_t i = 0; i < reads.size(); i++) {
+    index.AddRead(i, reads[i].str());
+  }
+}
+
+void BuildIndex(CompactReadIndex& index, const PackedReadStore& reads,
+                ThreadPool* thread_pool) {
+  index.Build(reads, thread_pool);
+}
+
+void FinalizeIndex(CompactReadIndex& index) {
+  index.Finalize();
+}
+
+template<class TIndex>
+bool LoadIndexCache(TIndex& index, const string& filename, uint64_t fingerprint) {
+  return false;
+}
+
+bool LoadIndexCache(CompactReadIndex& index, const string& filename, uint64_t fingerprint) {
+  return index.Load(filename, fingerprint);
+}
+
+template<class TIndex>
+void SaveIndexCache(const TIndex& index, const string& filename, uint64_t fingerprint) {}
+
+void SaveIndexCache(const CompactReadIndex& index, const string& filename, uint64_t fingerprint) {
+  if (!index.Save(filename, fingerprint)) {
+    fprintf(stderr, "Failed to save read index to %s\n", filename.c_str());
+  }
+}
+
+// FNV-1a over reads, separated by newline
+void UpdateFingerprint(uint64_t& fingerprint, const char* read, int length) {
+  for (int i = 0; i < length; i++) {
+    fingerprint = (fingerprint ^ (unsigned char) read[i]) * 1099511628211ULL;
+  }
+  fingerprint = (fingerprint ^ '\n') * 1099511628211ULL;
+}
+
+}
+
 template<class TIndex>
-void ReadSet<TIndex>::LoadReadSet(istream& is) {
-  string l1, l2, l3, l4;
+void ReadSet<TIndex>::LoadReadSet(FastxReader& reader, const string& index_cache) {
+  FastxRecord record;
   int id = 0;
-  while (getline(is, l1)) {
-    getline(is, l2);
-    getline(is, l3);
-    getline(is, l4);
-    reads_.push_back(l2);
-    index_.AddRead(id, l2);
+  uint64_t fingerprint = 14695981039346656037ULL;
+  while (reader.Next(record)) {
+    reads_.Add(record.seq, record.seq_length);
+    max_read_length_ = max(max_read_length_, record.seq_length);
+    UpdateFingerprint(fingerprint, record.seq, record.seq_length);
     id++;
     if (id % 10000 == 0) {
       printf("\rLoaded %d reads", id);
@@ -78,47 +548,150 @@ void ReadSet<TIndex>::LoadReadSet(istream& is) {
     }
   }
   printf("\n");
+  if (!reader.good()) {
+    fprintf(stderr, "Failed to read reads: %s\n", reader.error().c_str());
+  }
+
+  if (!index_cache.empty() && LoadIndexCache(index_, index_cache, fingerprint)) {
+    printf("Loaded read index from %s\n", index_cache.c_str());
+    return;
+  }
+  BuildIndex(index_, reads_, thread_pool_);
+  if (!index_cache.empty()) {
+    SaveIndexCache(index_, index_cache, fingerprint);
+  }
 }
 
 template<class TIndex>
 vector<ReadAlignment> ReadSet<TIndex>::GetAlignments(const string& genome) const {
+  SequenceView view;
+  view.Append(genome);
+  return GetAlignments(view);
+}
+
+template<class TIndex>
+vector<ReadAlignment> ReadSet<TIndex>::GetAlignments(const SequenceView& genome) const {
   vector<ReadAlignment> ret;
   GetAlignments(genome, false, ret);
-  string reversed_genome = ReverseSeq(genome);
-  GetAlignments(reversed_genome, true, ret);
+  GetAlignments(genome.GetReverseComplement(), true, ret);
   return ret;
 }
 
 template<class TIndex>
-void ReadSet<TIndex>::GetAlignments(const string& genome,
+void ReadSet<TIndex>::GetAlignments(const SequenceView& genome,
                                     bool reversed,
                                     vector<ReadAlignment>& output) const {
   vector<CandidateReadPosition> candidates = index_.GetReadCandidates(genome);
 
   sort(candidates.begin(), candidates.end());
 
+  const int min_candidates_per_chunk = 64;
+  int num_chunks = 1;
+  if (thread_pool_ != NULL) {
+    num_chunks = min(4 * thread_pool_->num_threads(),
+                     (int) candidates.size() / min_candidates_per_chunk);
+  }
+  if (num_chunks <= 1) {
+    VerifyCandidates(genome, reversed, candidates, 0, candidates.size(),
+                     GetThreadWorkspace(), output);
+    return;
+  }
+
+  // Chunks end at read boundaries and are merged in order, so the output
+  // is the same as from the serial run.
+  vector<int> chunk_starts = SplitAtReadBoundaries(candidates, num_chunks);
+
+  vector<vector<ReadAlignment>> chunk_outputs(num_chunks);
+  thread_pool_->ParallelFor(num_chunks, [&](int chunk) {
+    VerifyCandidates(genome, reversed, candidates, chunk_starts[chunk],
+                     chunk_starts[chunk+1], GetThreadWorkspace(), chunk_outputs[chunk]);
+  });
+  for (auto &chunk_output: chunk_outputs) {
+    output.insert(output.end(), chunk_output.begin(), chunk_output.end());
+  }
+}
+
+template<class TIndex>
+typename ReadSet<TIndex>::ExtensionWorkspace& ReadSet<TIndex>::GetThreadWorkspace() {
+  static thread_local ExtensionWorkspace workspace;
+  return workspace;
+}
+
+template<class TIndex>
+void ReadSet<TIndex>::VerifyCandidates(
+    const SequenceView& genome, bool reversed,
+    const vector<CandidateReadPosition>& candidates, int begin, int end,
+    ExtensionWorkspace& workspace, vector<ReadAlignment>& output) const {
   int last_read_id = -1;
   vector<ReadAlignment> buffer;
-  for (auto &cand: candidates) {
-    if (cand.read_id != last_read_id) {
-      output.insert(output.end(), buffer.begin(), buffer.end());
-      buffer.clear();
-    }
-    last_read_id = cand.read_id;
-    ReadAlignment al;
-    if (ExtendAlignment(cand, genome, al)) {
-      if (reversed) {
-        al.genome_pos = genome.size() - al.genome_pos - reads_[cand.read_id].size();
+  for (int block = begin; block < end; block += kVerifyBlockSize) {
+    int block_end = min(end, block + kVerifyBlockSize);
+    // Window of every candidate, cut by genome ends the same way as the
+    // whole genome would be
+    workspace.windows.resize(block_end - block);
+    workspace.window_starts.resize(block_end - block);
+    for (int i = block; i < block_end; i++) {
+      auto &cand = candidates[i];
+      int expected_start = cand.genome_pos - cand.read_pos;
+      int window_start = max(0, expected_start - kWindowMargin);
+      int window_end = min(genome.size(),
+                           expected_start + reads_.length(cand.read_id) + kWindowMargin);
+      string& window = workspace.windows[i - block];
+      window.resize(window_end - window_start);
+      genome.CopyTo(window_start, window_end - window_start, &window[0]);
+      workspace.window_starts[i - block] = window_start;
+    }
+
+    if (engine_ == VERIFY_BATCHED) {
+      workspace.tasks.clear();
+      for (int i = block; i < block_end; i++) {
+        auto &cand = candidates[i];
+        workspace.tasks.push_back(BandedTask(
+            reads_[cand.read_id], &workspace.windows[i - block],
+            cand.genome_pos - cand.read_pos - workspace.window_starts[i - block]));
+      }
+      workspace.batched.Align(workspace.tasks, kMaxErrors, workspace.dists,
+                              workspace.starts);
+    }
+
+    for (int i = block; i < block_end; i++) {
+      auto &cand = candidates[i];
+      if (cand.read_id != last_read_id) {
+        output.insert(output.end(), buffer.begin(), buffer.end());
+        buffer.clear();
       }
-      auto it = find_if(
-          buffer.begin(), buffer.end(),
-          [&al](const ReadAlignment& a) { return a.read_id == al.read_id && 
-                                                 a.genome_pos == al.genome_pos; });
-      if (it == buffer.end()) {
-        al.reversed = reversed;
-        buffer.push_back(al);
+      last_read_id = cand.read_id;
+      const string& window = workspace.windows[i - block];
+      int window_start = workspace.window_starts[i - block];
+      CandidateReadPosition window_cand(cand.read_id, cand.genome_pos - window_start,
+                                        cand.read_pos);
+      ReadAlignment al;
+      bool aligned;
+      if (engine_ == VERIFY_BATCHED) {
+        aligned = workspace.dists[i - block] <= kMaxErrors;
+        al.read_id = cand.read_id;
+        al.genome_pos = workspace.starts[i - block];
+        al.dist = workspace.dists[i - block];
+      } else if (engine_ == VERIFY_MYERS) {
+        aligned = AlignMyers(window_cand, window, al, workspace);
       } else {
-        it->dist = min(it->dist, al.dist);
+        aligned = ExtendAlignment(window_cand, window, al, workspace);
+      }
+      if (aligned) {
+        al.genome_pos += window_start;
+        if (reversed) {
+          al.genome_pos = genome.size() - al.genome_pos - reads_.length(cand.read_id);
+        }
+        auto it = find_if(
+            buffer.begin(), buffer.end(),
+            [&al](const ReadAlignment& a) { return a.read_id == al.read_id && 
+                                                   a.genome_pos == al.genome_pos; });
+        if (it == buffer.end()) {
+          al.reversed = reversed;
+          buffer.push_back(al);
+        } else {
+          it->dist = min(it->dist, al.dist);
+        }
       }
     }
   }
@@ -142,19 +715,28 @@ template<class TIndex>
 bool ReadSet<TIndex>::ExtendAlignment(const CandidateReadPosition& candidate,
                                       const string& genome,
                                       ReadAlignment& al) const {
-  int max_err_start = 6;
+  ExtensionWorkspace workspace;
+  return ExtendAlignment(candidate, genome, al, workspace);
+}
+
+template<class TIndex>
+bool ReadSet<TIndex>::ExtendAlignment(const CandidateReadPosition& candidate,
+                                      const string& genome,
+                                      ReadAlignment& al,
+                                      ExtensionWorkspace& workspace) const {
+  int max_err_start = kMaxErrors;
   int max_err = max_err_start;
-  // Static - we reuse memory and make fewer allocations
-  static VisitedPositions visited_positions;
+  // Workspace - we reuse memory and make fewer allocations
+  VisitedPositions& visited_positions = workspace.visited_positions;
 
   // indexing: distance -> read_pos -> list of genome_positions
-  auto& read = reads_[candidate.read_id];
+  PackedRead read = reads_[candidate.read_id];
   int total_errs = 0;
 
   visited_positions.Prepare(candidate.genome_pos, read.size());
 
   // distance, (read_pos, genome_pos)
-  static deque<pair<int, pair<int, int>>> fr;
+  deque<pair<int, pair<int, int>>>& fr = workspace.fr;
   fr.clear();
   fr.push_back(make_pair(0, make_pair(candidate.read_pos+1, candidate.genome_pos+1)));
 
@@ -266,6 +848,25 @@ bool ReadSet<TIndex>::ExtendAlignment(const CandidateReadPosition& candidate,
   return false;
 }
 
+template<class TIndex>
+bool ReadSet<TIndex>::AlignMyers(const CandidateReadPosition& candidate,
+                                 const string& genome,
+                                 ReadAlignment& al,
+                                 ExtensionWorkspace& workspace) const {
+  PackedRead read = reads_[candidate.read_id];
+  int expected_start = candidate.genome_pos - candidate.read_pos;
+  int begin = max(0, expected_start - kMaxErrors);
+  int end = min((int) genome.size(), expected_start + (int) read.size() + kMaxErrors);
+  int start, dist;
+  if (!workspace.myers.Align(read, genome, begin, end, expected_start, kMaxErrors,
+                             start, dist)) {
+    return false;
+  }
+  al.read_id = candidate.read_id;
+  al.genome_pos = start;
+  al.dist = dist;
+  return true;
+}
 
 template<class TIndex>
 void ReadSetPacBio<TIndex>::AlignedPairsSet::MarkAsAligned(vector<pair<int, int> >& alignedPairsVector) {
@@ -288,15 +889,12 @@ bool ReadSetPacBio<TIndex>::AlignedPairsSet::IsAligned(pair<int,int> seed) {
 
 
 template<class TIndex>
-void ReadSetPacBio<TIndex>::LoadReadSet(istream& is) {
-  string l1, l2, l3, l4;
+void ReadSetPacBio<TIndex>::LoadReadSet(FastxReader& reader) {
+  FastxRecord record;
   int id = 0;
-  while (getline(is, l1)) {
-    getline(is, l2);
-    getline(is, l3);
-    getline(is, l4);
-    reads_.push_back(Sequence(l2));
-    index_.AddRead(id, l2);
+  while (reader.Next(record)) {
+    reads_.push_back(Sequence(record.Seq()));
+    index_.AddRead(id, reads_.back().GetData());
     id++;
     if (id % 10000 == 0) {
       printf("\rLoaded %d reads", id);
@@ -304,6 +902,10 @@ void ReadSetPacBio<TIndex>::LoadReadSet(istream& is) {
     }
   }
   printf("\n");
+  if (!reader.good()) {
+    fprintf(stderr, "Failed to read reads: %s\n", reader.error().c_str());
+  }
+  FinalizeIndex(index_);
 }
 
 template<class TIndex>
@@ -330,10 +932,47 @@ void ReadSetPacBio<TIndex>::GetAlignments(Sequence& genome, bool reversed, vecto
   vector<CandidateReadPosition> candidates = index_.GetReadCandidates(genome.GetData());
   
   sort(candidates.begin(), candidates.end());
+
+  // Alignments are much more expensive than in ReadSet, so chunks can be
+  // smaller
+  const int min_candidates_per_chunk = 16;
+  int num_chunks = 1;
+  if (thread_pool_ != NULL) {
+    num_chunks = min(4 * thread_pool_->num_threads(),
+                     (int) candidates.size() / min_candidates_per_chunk);
+  }
+  if (num_chunks <= 1) {
+    dalign::Work_Data* work_data = dalign_.AcquireWorkData();
+    AlignCandidates(genome, reversed, candidates, 0, candidates.size(), work_data, output);
+    dalign_.ReleaseWorkData(work_data);
+    return;
+  }
+
+  // Converted lazily, so do it before the genome is shared. Every read is
+  // in one chunk only.
+  genome.ToDalignFromat();
+  vector<int> chunk_starts = SplitAtReadBoundaries(candidates, num_chunks);
+  vector<vector<ReadAlignmentPacBio>> chunk_outputs(num_chunks);
+  thread_pool_->ParallelFor(num_chunks, [&](int chunk) {
+    dalign::Work_Data* work_data = dalign_.AcquireWorkData();
+    AlignCandidates(genome, reversed, candidates, chunk_starts[chunk], chunk_starts[chunk+1],
+                    work_data, chunk_outputs[chunk]);
+    dalign_.ReleaseWorkData(work_data);
+  });
+  for (auto &chunk_output: chunk_outputs) {
+    output.insert(output.end(), chunk_output.begin(), chunk_output.end());
+  }
+}
+
+template<class TIndex>
+void ReadSetPacBio<TIndex>::AlignCandidates(
+    Sequence& genome, bool reversed, const vector<CandidateReadPosition>& candidates,
+    int begin, int end, dalign::Work_Data* work_data, vector<ReadAlignmentPacBio>& output) {
   AlignedPairsSet alignedPairs;
   
   int lastId = -1;
-  for (auto& candidate : candidates) {
+  for (int i = begin; i < end; i++) {
+    auto& candidate = candidates[i];
     if (candidate.read_id != lastId) {
       alignedPairs = AlignedPairsSet();
     }
@@ -345,7 +984,8 @@ void ReadSetPacBio<TIndex>::GetAlignments(Sequence& genome, bool reversed, vecto
     
     Alignment al;
     Sequence &read = reads_[candidate.read_id];
-    dalign_.ComputeAlignment(genome, read, pair<int, int>(candidate.genome_pos, candidate.read_pos), al);
+    dalign_.ComputeAlignment(genome, read, pair<int, int>(candidate.genome_pos, candidate.read_pos),
+                             al, work_data);
     int length = (al.GetLengthOnA() + al.GetLengthOnB()) / 2;
     
     if (length >= minSufficientLength) {
@@ -374,7 +1014,20 @@ void ReadSetPacBio<TIndex>::GetAlignments(Sequence& genome, bool reversed, vecto
   }
 }
 
+template<class TIndex>
+const int ReadSet<TIndex>::kMaxErrors;
+template<class TIndex>
+const int ReadSet<TIndex>::kWindowMargin;
+template<class TIndex>
+const int ReadSet<TIndex>::kVerifyBlockSize;
+
 template class ReadSet<StandardReadIndex>;
 template class ReadSet<RandomIndex>;
+template class ReadSet<PackedStandardReadIndex>;
+template class ReadSet<PackedRandomIndex>;
+template class ReadSet<CompactReadIndex>;
 template class ReadSetPacBio<StandardReadIndex>;
 template class ReadSetPacBio<RandomIndex>;
+template class ReadSetPacBio<PackedStandardReadIndex>;
+template class ReadSetPacBio<PackedRandomIndex>;
+template class ReadSetPacBio<CompactReadIndex>;
@@ -2,12 +2,19 @@
 #define READ_SET_H__
 
 #include <string>
+#include <cstdint>
 #include <fstream>
 #include <unordered_map>
 #include <vector>
 #include <gtest/gtest.h>
 #include "Sequence.h"
 #include "DalignWrapper.h"
+#include "thread_pool.h"
+#include "edit_distance.h"
+#include "fastx_reader.h"
+#include "packed_read_store.h"
+#include "sequence_view.h"
+#include <deque>
 #include <unordered_set>
 using namespace std;
 
@@ -52,6 +59,7 @@ class StandardReadIndex {
   void AddRead(int id, const string& data);
 
   vector<CandidateReadPosition> GetReadCandidates(const string& genome) const;
+  vector<CandidateReadPosition> GetReadCandidates(const SequenceView& genome) const;
 
   int k_;
   // (read_id, pos_in_read)
@@ -64,13 +72,129 @@ class RandomIndex {
   void AddRead(int id, const string& data);
 
   vector<CandidateReadPosition> GetReadCandidates(const string& genome) const;
+  vector<CandidateReadPosition> GetReadCandidates(const SequenceView& genome) const;
 
   int k_;
   // (read_id, pos_in_read)
   unordered_map<string, vector<pair<int,int>>> index_; 
 };
 
-template<class TIndex=RandomIndex>
+// Same as StandardReadIndex, but k-mers are packed into 2 bits per base
+// (k <= 32), so candidate lookup does not allocate strings.
+// K-mers containing other bases than ACGT are not indexed.
+class PackedStandardReadIndex {
+ public:
+  PackedStandardReadIndex(int k = 13): k_(k) {}
+  void AddRead(int id, const string& data);
+
+  vector<CandidateReadPosition> GetReadCandidates(const string& genome) const;
+  vector<CandidateReadPosition> GetReadCandidates(const SequenceView& genome) const;
+
+  int k_;
+  // (read_id, pos_in_read)
+  unordered_map<uint64_t, vector<pair<int,int>>> index_;
+};
+
+// Same as RandomIndex with 2-bit packed k-mers.
+class PackedRandomIndex {
+ public:
+  PackedRandomIndex(int k = 13): k_(k) {}
+  void AddRead(int id, const string& data);
+
+  vector<CandidateReadPosition> GetReadCandidates(const string& genome) const;
+  vector<CandidateReadPosition> GetReadCandidates(const SequenceView& genome) const;
+
+  int k_;
+  // (read_id, pos_in_read)
+  unordered_map<uint64_t, vector<pair<int,int>>> index_;
+};
+
+// Static index stored in flat arrays: sorted distinct 2-bit packed k-mers
+// with offsets into postings, and postings (read_id << 32 | pos_in_read).
+// AddRead only collects k-mers, Finalize builds the arrays.
+// Index can be saved to a file and later memory mapped instead of rebuilt.
+class CompactReadIndex {
+ public:
+  // sampled_kmers random k-mers are taken from each read (as in
+  // RandomIndex), 0 means all k-mers (as in StandardReadIndex).
+  CompactReadIndex(int k = 13, int sampled_kmers = 3) :
+      k_(k), sampled_kmers_(sampled_kmers), keys_(NULL), offsets_(NULL),
+      postings_(NULL), num_keys_(0), mapped_(NULL), mapped_size_(0) {}
+  ~CompactReadIndex();
+
+  void AddRead(int id, const string& data);
+  void Finalize();
+
+  // Replaces index with index of all reads (read ids are positions in
+  // reads), built in thread_pool if not NULL. Same as AddRead of every read
+  // followed by Finalize.
+  void Build(const PackedReadStore& reads, ThreadPool* thread_pool);
+
+  vector<CandidateReadPosition> GetReadCandidates(const string& genome) const;
+  vector<CandidateReadPosition> GetReadCandidates(const SequenceView& genome) const;
+
+  // fingerprint identifies the read set, Load fails if it does not match
+  // the saved one (or k and sampling differ).
+  bool Save(const string& filename, uint64_t fingerprint) const;
+  bool Load(const string& filename, uint64_t fingerprint);
+
+  size_t num_keys() const {
+    return num_keys_;
+  }
+
+  size_t num_postings() const {
+    return num_keys_ == 0 ? 0 : offsets_[num_keys_];
+  }
+
+  int k_;
+  int sampled_kmers_;
+
+ private:
+  CompactReadIndex(const CompactReadIndex&);
+  CompactReadIndex& operator=(const CompactReadIndex&);
+
+  void Unmap();
+
+  template<class TSeq>
+  vector<CandidateReadPosition> GetCandidates(const TSeq& genome) const;
+
+  // Fills arrays from shards of (kmer, posting), which are sorted and
+  // ordered by k-mer. Shards are freed.
+  void BuildFromShards(vector<vector<pair<uint64_t, uint64_t>>>& shards,
+                       ThreadPool* thread_pool);
+
+  // (kmer, posting) collected by AddRead
+  vector<pair<uint64_t, uint64_t>> pending_;
+
+  // Arrays owned by the index (after Finalize)
+  vector<uint64_t> keys_storage_;
+  vector<uint64_t> offsets_storage_;
+  vector<uint64_t> postings_storage_;
+
+  // Views of either owned or memory mapped arrays, postings of keys_[i]
+  // are postings_[offsets_[i]] ... postings_[offsets_[i+1]-1].
+  const uint64_t* keys_;
+  const uint64_t* offsets_;
+  const uint64_t* postings_;
+  size_t num_keys_;
+
+  void* mapped_;
+  size_t mapped_size_;
+};
+
+// How ReadSet checks candidate positions
+enum VerificationEngine {
+  // Breadth first search over edits from the seed
+  VERIFY_BFS,
+  // Bit-parallel edit distance in window around the seed
+  VERIFY_MYERS,
+  // Banded edit distance of many candidates at once in SIMD lanes. Faster
+  // verification, but candidate search dominates GetAlignments, so overall
+  // it is about as fast as BFS (see align_benchmark).
+  VERIFY_BATCHED
+};
+
+template<class TIndex=CompactReadIndex>
 class ReadSet {
   class VisitedPositions {
    vector<vector<int>> vp_;
@@ -89,38 +213,117 @@ class ReadSet {
     }
   };
 
+  // Memory reused by ExtendAlignment, one per thread
+  struct ExtensionWorkspace {
+    VisitedPositions visited_positions;
+    // distance, (read_pos, genome_pos)
+    deque<pair<int, pair<int, int>>> fr;
+    MyersAligner myers;
+    BatchedAligner batched;
+    vector<BandedTask> tasks;
+    vector<int> dists;
+    vector<int> starts;
+    // Copies of genome around candidates being verified
+    vector<string> windows;
+    vector<int> window_starts;
+  };
+
+  static ExtensionWorkspace& GetThreadWorkspace();
+
  public:
-  ReadSet() {}
+  ReadSet() : max_read_length_(0), thread_pool_(NULL), engine_(VERIFY_BFS) {}
+
+  // If index_cache is not empty, index is loaded from it when it was built
+  // for the same reads, otherwise index is built and saved there (only
+  // CompactReadIndex supports this).
+  void LoadReadSet(const string& filename, const string& index_cache = "") {
+    FastxReader reader(filename);
+    LoadReadSet(reader, index_cache);
+  }
 
-  void LoadReadSet(const string& filename) {
-    ifstream is(filename);
-    LoadReadSet(is);
+  void LoadReadSet(istream& is, const string& index_cache = "") {
+    FastxReader reader(is);
+    LoadReadSet(reader, index_cache);
   }
 
-  void LoadReadSet(istream& is);
+  void LoadReadSet(FastxReader& reader, const string& index_cache = "");
 
   // Two sided get
   vector<ReadAlignment> GetAlignments(const string& genome) const;
+  // Same as above, the genome is not copied (only windows around
+  // candidates are)
+  vector<ReadAlignment> GetAlignments(const SequenceView& genome) const;
 
   size_t size() const {
     return reads_.size();
   }
 
-  const string& operator[](int i) const {
+  // Read is stored packed, use str() to get string
+  PackedRead operator[](int i) const {
     return reads_[i];
   }
 
+  int read_length(int i) const {
+    return reads_.length(i);
+  }
+
+  int max_read_length() const {
+    return max_read_length_;
+  }
+
+  // Candidates in GetAlignments are verified in pool (NULL means serially)
+  // and index is built in it when set before LoadReadSet. Results are the
+  // same as in serial run.
+  void SetThreadPool(ThreadPool* thread_pool) {
+    thread_pool_ = thread_pool;
+  }
+
+  ThreadPool* thread_pool() const {
+    return thread_pool_;
+  }
+
+  void SetVerificationEngine(VerificationEngine engine) {
+    engine_ = engine;
+  }
+
+  // Alignments with more edits are not reported
+  static const int kMaxErrors = 6;
+
  private:
+  // Verification does not look further than kMaxErrors from where the read
+  // would be without indels, windows copied for it keep more than that
+  static const int kWindowMargin = 2 * kMaxErrors;
+  // Candidates whose windows are copied at once
+  static const int kVerifyBlockSize = 256;
+
   // One sided get
-  void GetAlignments(const string& genome, bool reversed, vector<ReadAlignment>& output) const;
+  void GetAlignments(const SequenceView& genome, bool reversed,
+                     vector<ReadAlignment>& output) const;
+
+  // Verifies candidates[begin, end), which are sorted and do not split
+  // candidates of one read with the rest of candidates.
+  void VerifyCandidates(const SequenceView& genome, bool reversed,
+                        const vector<CandidateReadPosition>& candidates,
+                        int begin, int end, ExtensionWorkspace& workspace,
+                        vector<ReadAlignment>& output) const;
 
   bool ExtendAlignment(const CandidateReadPosition& candidate, const string& genome,
                        ReadAlignment& al) const;
+  bool ExtendAlignment(const CandidateReadPosition& candidate, const string& genome,
+                       ReadAlignment& al, ExtensionWorkspace& workspace) const;
 
-  vector<string> reads_;
+  // Alternative to ExtendAlignment using MyersAligner
+  bool AlignMyers(const CandidateReadPosition& candidate, const string& genome,
+                  ReadAlignment& al, ExtensionWorkspace& workspace) const;
+
+  PackedReadStore reads_;
+  int max_read_length_;
   TIndex index_;
+  ThreadPool* thread_pool_;
+  VerificationEngine engine_;
 
   FRIEND_TEST(ReadSetTest, ExtendAlignTest);
+  FRIEND_TEST(ReadSetTest, AlignMyersTest);
 };
 
 
@@ -150,13 +353,21 @@ class ReadSetPacBio {
   };
   
 public:
-  ReadSetPacBio() {
+  ReadSetPacBio() : thread_pool_(NULL) {
     SetParameters(0.7, {0.25, 0.25, 0.25, 0.25}, 100);
   }
     
-  void LoadReadSet(const string& filename);
+  void LoadReadSet(const string& filename) {
+    FastxReader reader(filename);
+    LoadReadSet(reader);
+  }
+
+  void LoadReadSet(istream& is) {
+    FastxReader reader(is);
+    LoadReadSet(reader);
+  }
 
-  void LoadReadSet(istream& is);
+  void LoadReadSet(FastxReader& reader);
 
   // Two sided get
   vector<ReadAlignmentPacBio> GetAlignments(const string& genome);
@@ -170,11 +381,23 @@ public:
   }
   
   void SetParameters(float corelation, const array<float, 4>& frequencies, int minSufficientLength_);
+
+  // Candidates in GetAlignments are aligned in pool (NULL means serially),
+  // each thread with its own DALIGN work data. Results are the same as in
+  // serial run.
+  void SetThreadPool(ThreadPool* thread_pool) {
+    thread_pool_ = thread_pool;
+  }
   
 private:
   
   // One sided get
   void GetAlignments(Sequence& genome, bool reversed, vector<ReadAlignmentPacBio>& output);
+
+  // Aligns candidates [begin, end), which are sorted and do not split a read
+  void AlignCandidates(Sequence& genome, bool reversed,
+                       const vector<CandidateReadPosition>& candidates, int begin, int end,
+                       dalign::Work_Data* work_data, vector<ReadAlignmentPacBio>& output);
   
   vector<Sequence> reads_;
   
@@ -183,6 +406,8 @@ private:
   DalignWrapper dalign_;
   
   int minSufficientLength;
+
+  ThreadPool* thread_pool_;
 };
 
 #endif
@@ -4,6 +4,10 @@
 #include <tuple>
 #include <set>
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include "util.h"
 
 TEST(StandardReadIndexTest, GetCandidatesTest) {
@@ -22,6 +26,180 @@ TEST(StandardReadIndexTest, GetCandidatesTest) {
   EXPECT_EQ(expected, index.GetReadCandidates("GGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGG"));
 }
 
+TEST(PackedStandardReadIndexTest, GetCandidatesTest) {
+  PackedStandardReadIndex index(13);
+  //             12345678901234567890
+  index.AddRead(1, "AAAAAAAAAAAAAACCCTTT");
+  index.AddRead(2, "AAAAAACCCTTTTTTTTTTT");
+
+  vector<CandidateReadPosition> result = index.GetReadCandidates(
+      "AAAAACCCTTTTTTTTTTTTTTTTTTTTTTTTT");
+  vector<CandidateReadPosition> expected;
+  expected.push_back(CandidateReadPosition(2, 0, 1));
+  EXPECT_EQ(expected, result);
+
+  expected.clear();
+  EXPECT_EQ(expected, index.GetReadCandidates("GGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGG"));
+}
+
+TEST(PackedStandardReadIndexTest, SkipNTest) {
+  PackedStandardReadIndex index(5);
+  index.AddRead(0, "ACGTNACGTA");
+
+  vector<CandidateReadPosition> expected;
+  EXPECT_EQ(expected, index.GetReadCandidates("CGTNA"));
+  expected.push_back(CandidateReadPosition(0, 2, 5));
+  EXPECT_EQ(expected, index.GetReadCandidates("NNACGTAN"));
+}
+
+TEST(ReadSetTest, PackedIndexGetAlignmentsTest) {
+  string part1 = "";
+  string part2 = "";
+  srand(47);
+  char alph[] = "ACGT";
+  for (int i = 0; i < 50; i++) {
+    part1 += alph[rand()%4];
+    part2 += alph[rand()%4];
+  }
+
+  stringstream ss;
+  ss << "@a" << endl;
+  ss << part1 << part2 << endl;
+  ss << "+" << endl;
+  ss << part1 << part2 << endl;
+
+  ReadSet<PackedRandomIndex> rs;
+  rs.LoadReadSet(ss);
+
+  string genome = "ACGTTT" + part1 + "ACTGAA" + part2 + "GTCT";
+  vector<ReadAlignment> als = rs.GetAlignments(genome);
+  ASSERT_EQ(1, als.size());
+  EXPECT_EQ(false, als[0].reversed);
+  EXPECT_EQ(6, als[0].genome_pos);
+  EXPECT_EQ(0, als[0].read_id);
+  EXPECT_EQ(6, als[0].dist);
+
+  genome = "ACGTTT" + ReverseSeq(part1+part2) + "GTCT";
+  als = rs.GetAlignments(genome);
+  ASSERT_EQ(1, als.size());
+  EXPECT_EQ(true, als[0].reversed);
+  EXPECT_EQ(6, als[0].genome_pos);
+  EXPECT_EQ(0, als[0].dist);
+}
+
+TEST(CompactReadIndexTest, GetCandidatesTest) {
+  CompactReadIndex index(13, 0);
+  //             12345678901234567890
+  index.AddRead(1, "AAAAAAAAAAAAAACCCTTT");
+  index.AddRead(2, "AAAAAACCCTTTTTTTTTTT");
+  index.Finalize();
+
+  vector<CandidateReadPosition> result = index.GetReadCandidates(
+      "AAAAACCCTTTTTTTTTTTTTTTTTTTTTTTTT");
+  vector<CandidateReadPosition> expected;
+  expected.push_back(CandidateReadPosition(2, 0, 1));
+  EXPECT_EQ(expected, result);
+
+  expected.clear();
+  EXPECT_EQ(expected, index.GetReadCandidates("GGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGGG"));
+}
+
+TEST(CompactReadIndexTest, SaveLoadTest) {
+  const string filename = "compact_read_index_test.idx";
+  CompactReadIndex index(13, 0);
+  index.AddRead(1, "AAAAAAAAAAAAAACCCTTT");
+  index.AddRead(2, "AAAAAACCCTTTTTTTTTTT");
+  index.Finalize();
+  ASSERT_TRUE(index.Save(filename, 47));
+
+  CompactReadIndex loaded(13, 0);
+  EXPECT_FALSE(loaded.Load(filename, 48));
+  CompactReadIndex other_k(15, 0);
+  EXPECT_FALSE(other_k.Load(filename, 47));
+  ASSERT_TRUE(loaded.Load(filename, 47));
+  EXPECT_EQ(index.num_keys(), loaded.num_keys());
+  EXPECT_EQ(index.num_postings(), loaded.num_postings());
+
+  string genome = "AAAAACCCTTTTTTTTTTTTTTTTTTTTTTTTTAAAAAAAAAAAAAACC";
+  EXPECT_EQ(index.GetReadCandidates(genome), loaded.GetReadCandidates(genome));
+
+  // Corrupted files are rejected: number of keys which makes the expected
+  // size overflow to the real one, and offsets out of order
+  ifstream is(filename, ios::binary);
+  string data((istreambuf_iterator<char>(is)), istreambuf_iterator<char>());
+  is.close();
+  uint64_t num_keys;
+  memcpy(&num_keys, &data[32], sizeof(num_keys));
+  for (int corruption = 0; corruption < 3; corruption++) {
+    string corrupted = data;
+    if (corruption == 0) {
+      uint64_t overflowing = num_keys + (1ULL << 62);
+      memcpy(&corrupted[32], &overflowing, sizeof(overflowing));
+    } else {
+      size_t offset_pos = 48 + (num_keys + (corruption == 1 ? 1 : num_keys)) * 8;
+      uint64_t offset = 1000;
+      memcpy(&corrupted[offset_pos], &offset, sizeof(offset));
+    }
+    ofstream of(filename, ios::binary);
+    of.write(corrupted.data(), corrupted.size());
+    of.close();
+    CompactReadIndex corrupted_index(13, 0);
+    EXPECT_FALSE(corrupted_index.Load(filename, 47));
+  }
+  remove(filename.c_str());
+}
+
+TEST(CompactReadIndexTest, ParallelBuildTest) {
+  srand(47);
+  char alph[] = "ACGT";
+  string genome;
+  for (int i = 0; i < 20000; i++) {
+    genome += alph[rand()%4];
+  }
+  PackedReadStore reads;
+  for (int i = 0; i < 5000; i++) {
+    string read = genome.substr(rand() % (genome.size() - 100), 100);
+    if (i % 10 == 0) read[50] = 'N';
+    reads.Add(read);
+  }
+
+  ThreadPool pool(4);
+  for (int sampled_kmers: {0, 3}) {
+    CompactReadIndex serial(13, sampled_kmers);
+    for (size_t i = 0; i < reads.size(); i++) {
+      serial.AddRead(i, reads[i].str());
+    }
+    serial.Finalize();
+    CompactReadIndex parallel(13, sampled_kmers);
+    parallel.Build(reads, &pool);
+    EXPECT_EQ(serial.num_keys(), parallel.num_keys());
+    EXPECT_EQ(serial.num_postings(), parallel.num_postings());
+    EXPECT_EQ(serial.GetReadCandidates(genome), parallel.GetReadCandidates(genome));
+  }
+}
+
+TEST(ReadSetTest, IndexCacheTest) {
+  const string filename = "read_set_index_cache_test.idx";
+  remove(filename.c_str());
+  string read = "AAAACCCCTTTTGGGGACGTACGT";
+  stringstream ss;
+  ss << "@a" << endl << read << endl << "+" << endl << read << endl;
+
+  ReadSet<> rs;
+  rs.LoadReadSet(ss, filename);
+  vector<ReadAlignment> als = rs.GetAlignments("GG" + read + "CC");
+
+  stringstream ss2(ss.str());
+  ReadSet<> cached_rs;
+  cached_rs.LoadReadSet(ss2, filename);
+  vector<ReadAlignment> cached_als = cached_rs.GetAlignments("GG" + read + "CC");
+  ASSERT_EQ(1, als.size());
+  ASSERT_EQ(1, cached_als.size());
+  EXPECT_EQ(2, cached_als[0].genome_pos);
+  EXPECT_EQ(0, cached_als[0].dist);
+  remove(filename.c_str());
+}
+
 TEST(ReadSetTest, LoadTest) {
   stringstream ss;
   ss << "@aaa" << endl;
@@ -33,7 +211,7 @@ TEST(ReadSetTest, LoadTest) {
   rs.LoadReadSet(ss);
 
   ASSERT_EQ(1, rs.size());
-  EXPECT_EQ("AAGGCTG", rs[0]);
+  EXPECT_EQ("AAGGCTG", rs[0].str());
 }
 
 TEST(ReadSetTest, ExtendAlignTest) {
@@ -103,6 +281,117 @@ TEST(ReadSetTest, ExtendAlignTest) {
   EXPECT_EQ(3, al.genome_pos);
 }
 
+TEST(ReadSetTest, AlignMyersTest) {
+  stringstream ss;
+  ss << "@a" << endl;
+  ss << "AAAACCCCTTTTGGGG" << endl;
+  ss << "+" << endl;
+  ss << "AAAAAAAAAAAAAAAA" << endl;
+
+  ReadSet<> rs;
+  rs.LoadReadSet(ss);
+  ReadSet<>::ExtensionWorkspace workspace;
+
+  CandidateReadPosition candidate(0, 0, 0);
+  ReadAlignment al;
+  EXPECT_EQ(true, rs.AlignMyers(candidate, "AAAACCCCTTTTGGGGAAA", al, workspace));
+  EXPECT_EQ(0, al.read_id);
+  EXPECT_EQ(0, al.dist);
+  EXPECT_EQ(0, al.genome_pos);
+
+  EXPECT_EQ(true, rs.AlignMyers(candidate, "AAAACCCCTTTTGGTG", al, workspace));
+  EXPECT_EQ(1, al.dist);
+  EXPECT_EQ(0, al.genome_pos);
+
+  EXPECT_EQ(true, rs.AlignMyers(candidate, "AAAACCCCTTTTGGT", al, workspace));
+  EXPECT_EQ(2, al.dist);
+  EXPECT_EQ(0, al.genome_pos);
+
+  EXPECT_EQ(true, rs.AlignMyers(candidate, "AAAACCAAAATTGGGG", al, workspace));
+  EXPECT_EQ(4, al.dist);
+  EXPECT_EQ(0, al.genome_pos);
+
+  candidate.genome_pos = 5;
+  candidate.read_pos = 2;
+  EXPECT_EQ(true, rs.AlignMyers(candidate, "CACAAAACCCCTTTTGGGG", al, workspace));
+  EXPECT_EQ(0, al.dist);
+  EXPECT_EQ(3, al.genome_pos);
+
+  EXPECT_EQ(true, rs.AlignMyers(candidate, "CACATAACCCCTTTTGGGG", al, workspace));
+  EXPECT_EQ(1, al.dist);
+  EXPECT_EQ(3, al.genome_pos);
+}
+
+TEST(ReadSetTest, GetAlignmentsMyersTest) {
+  string part1 = "";
+  string part2 = "";
+  srand(47);
+  char alph[] = "ACGT";
+  for (int i = 0; i < 50; i++) {
+    part1 += alph[rand()%4];
+    part2 += alph[rand()%4];
+  }
+
+  stringstream ss;
+  ss << "@a" << endl;
+  ss << part1 << part2 << endl;
+  ss << "+" << endl;
+  ss << part1 << part2 << endl;
+
+  ReadSet<> rs;
+  rs.LoadReadSet(ss);
+  rs.SetVerificationEngine(VERIFY_MYERS);
+
+  string genome = "ACGTTT" + part1 + "ACTGAA" + part2 + "GTCT";
+  vector<ReadAlignment> als = rs.GetAlignments(genome);
+  ASSERT_EQ(1, als.size());
+  EXPECT_EQ(false, als[0].reversed);
+  EXPECT_EQ(6, als[0].genome_pos);
+  EXPECT_EQ(6, als[0].dist);
+
+  genome = "ACGTTT" + ReverseSeq(part1+part2) + "GTCT";
+  als = rs.GetAlignments(genome);
+  ASSERT_EQ(1, als.size());
+  EXPECT_EQ(true, als[0].reversed);
+  EXPECT_EQ(6, als[0].genome_pos);
+  EXPECT_EQ(0, als[0].dist);
+}
+
+TEST(ReadSetTest, GetAlignmentsBatchedTest) {
+  string part1 = "";
+  string part2 = "";
+  srand(47);
+  char alph[] = "ACGT";
+  for (int i = 0; i < 50; i++) {
+    part1 += alph[rand()%4];
+    part2 += alph[rand()%4];
+  }
+
+  stringstream ss;
+  ss << "@a" << endl;
+  ss << part1 << part2 << endl;
+  ss << "+" << endl;
+  ss << part1 << part2 << endl;
+
+  ReadSet<> rs;
+  rs.LoadReadSet(ss);
+  rs.SetVerificationEngine(VERIFY_BATCHED);
+
+  string genome = "ACGTTT" + part1 + "ACTGAA" + part2 + "GTCT";
+  vector<ReadAlignment> als = rs.GetAlignments(genome);
+  ASSERT_EQ(1, als.size());
+  EXPECT_EQ(false, als[0].reversed);
+  EXPECT_EQ(6, als[0].genome_pos);
+  EXPECT_EQ(6, als[0].dist);
+
+  genome = "ACGTTT" + ReverseSeq(part1+part2) + "GTCT";
+  als = rs.GetAlignments(genome);
+  ASSERT_EQ(1, als.size());
+  EXPECT_EQ(true, als[0].reversed);
+  EXPECT_EQ(6, als[0].genome_pos);
+  EXPECT_EQ(0, als[0].dist);
+}
+
 TEST(ReadSetTest, GetAlignmentsTest) {
   stringstream ss;
   ss << "@a" << endl;
@@ -269,6 +558,82 @@ TEST(ReadSetTest, GetAlignmentsTestMoreReads) {
   EXPECT_EQ(6, als[1].dist);
 }
 
+TEST(ReadSetTest, GetAlignmentsFromViewTest) {
+  srand(47);
+  char alph[] = "ACGT";
+  string genome = "";
+  for (int i = 0; i < 3000; i++) {
+    genome += alph[rand()%4];
+  }
+  stringstream ss;
+  for (int i = 0; i < 300; i++) {
+    string read = genome.substr(rand() % (genome.size() - 100), 100);
+    read[rand() % 100] = alph[rand()%4];
+    if (rand()%2) read = ReverseSeq(read);
+    ss << "@r" << i << endl << read << endl << "+" << endl << read << endl;
+  }
+  // Same genome from three pieces, the middle one stored reverse complemented
+  string middle = ReverseSeq(genome.substr(1000, 1000));
+  SequenceView view;
+  view.Append(genome.data(), 1000);
+  view.Append(middle.data(), middle.size(), true);
+  view.Append(genome.data() + 2000, 1000);
+
+  ReadSet<> rs;
+  rs.LoadReadSet(ss);
+  for (auto engine: {VERIFY_BFS, VERIFY_MYERS, VERIFY_BATCHED}) {
+    rs.SetVerificationEngine(engine);
+    vector<ReadAlignment> als = rs.GetAlignments(genome);
+    vector<ReadAlignment> view_als = rs.GetAlignments(view);
+    ASSERT_LT(250, als.size());
+    ASSERT_EQ(als.size(), view_als.size());
+    for (size_t i = 0; i < als.size(); i++) {
+      EXPECT_EQ(als[i].read_id, view_als[i].read_id);
+      EXPECT_EQ(als[i].genome_pos, view_als[i].genome_pos);
+      EXPECT_EQ(als[i].dist, view_als[i].dist);
+      EXPECT_EQ(als[i].reversed, view_als[i].reversed);
+    }
+  }
+}
+
+TEST(ReadSetTest, ParallelGetAlignmentsTest) {
+  srand(47);
+  char alph[] = "ACGT";
+  string genome = "";
+  for (int i = 0; i < 5000; i++) {
+    genome += alph[rand()%4];
+  }
+  stringstream ss;
+  for (int i = 0; i < 1000; i++) {
+    string read = genome.substr(rand() % (genome.size() - 100), 100);
+    read[rand() % 100] = alph[rand()%4];
+    if (rand()%2) read = ReverseSeq(read);
+    ss << "@r" << i << endl << read << endl << "+" << endl << read << endl;
+  }
+
+  srand(47);
+  stringstream ss2(ss.str());
+  ReadSet<> rs;
+  rs.LoadReadSet(ss2);
+  srand(47);
+  stringstream ss3(ss.str());
+  ReadSet<> parallel_rs;
+  parallel_rs.LoadReadSet(ss3);
+  ThreadPool pool(4);
+  parallel_rs.SetThreadPool(&pool);
+
+  vector<ReadAlignment> als = rs.GetAlignments(genome);
+  vector<ReadAlignment> parallel_als = parallel_rs.GetAlignments(genome);
+  ASSERT_LT(900, als.size());
+  ASSERT_EQ(als.size(), parallel_als.size());
+  for (size_t i = 0; i < als.size(); i++) {
+    EXPECT_EQ(als[i].read_id, parallel_als[i].read_id);
+    EXPECT_EQ(als[i].genome_pos, parallel_als[i].genome_pos);
+    EXPECT_EQ(als[i].dist, parallel_als[i].dist);
+    EXPECT_EQ(als[i].reversed, parallel_als[i].reversed);
+  }
+}
+
 char GetRandomBase(char otherThan = 'X') {
   char c = 'A';
   do {
@@ -404,3 +769,45 @@ TEST(ReadSetTest, PacBioTest) {
   // all reads must be found
   EXPECT_EQ(numReads, alignedReadsIds.size());
 }
+
+TEST(ReadSetTest, ParallelPacBioTest) {
+  srand(47);
+  string genome;
+  for (int i = 0; i < 10000; i++) {
+    genome += GetRandomBase();
+  }
+  stringstream fastqStream;
+  for (int j = 0; j < 40; j++) {
+    string read = genome.substr(rand() % (genome.size() - 1000), 1000);
+    for (auto &c : read) {
+      if (rand() % 100 < 5) c = GetRandomBase(c);
+    }
+    if (rand() % 2) read = RemapReverse(read);
+    fastqStream << "@read" << j << endl << read << endl << "+" << endl << read << endl;
+  }
+
+  ReadSetPacBio<StandardReadIndex> rs;
+  rs.SetParameters(0.90, {0.25, 0.25, 0.25, 0.25}, 500);
+  stringstream ss(fastqStream.str());
+  rs.LoadReadSet(ss);
+  ReadSetPacBio<StandardReadIndex> parallel_rs;
+  parallel_rs.SetParameters(0.90, {0.25, 0.25, 0.25, 0.25}, 500);
+  stringstream ss2(fastqStream.str());
+  parallel_rs.LoadReadSet(ss2);
+  ThreadPool pool(4);
+  parallel_rs.SetThreadPool(&pool);
+
+  vector<ReadAlignmentPacBio> als = rs.GetAlignments(genome);
+  vector<ReadAlignmentPacBio> parallel_als = parallel_rs.GetAlignments(genome);
+  ASSERT_LE(40, als.size());
+  ASSERT_EQ(als.size(), parallel_als.size());
+  for (size_t i = 0; i < als.size(); i++) {
+    EXPECT_EQ(als[i].read_id, parallel_als[i].read_id);
+    EXPECT_EQ(als[i].genome_first, parallel_als[i].genome_first);
+    EXPECT_EQ(als[i].genome_last, parallel_als[i].genome_last);
+    EXPECT_EQ(als[i].read_first, parallel_als[i].read_first);
+    EXPECT_EQ(als[i].read_last, parallel_als[i].read_last);
+    EXPECT_EQ(als[i].dist, parallel_als[i].dist);
+    EXPECT_EQ(als[i].reversed, parallel_als[i].reversed);
+  }
+}
@@ -0,0 +1,64 @@
+#include "read_probability_calculator.h"
+#include "graph.h"
+#include "util.h"
+#include <chrono>
+#include <sstream>
+
+// Measures cost of scoring one proposal in SingleReadProbabilityCalculator
+// when alignments of paths are already cached, i.e. cost of turning
+// alignments into probability.
+// Usage: scoring_benchmark [node_length] [num_reads] [iterations]
+int main(int argc, char** argv) {
+  int node_length = argc > 1 ? atoi(argv[1]) : 200000;
+  int num_reads = argc > 2 ? atoi(argv[2]) : 100000;
+  int iterations = argc > 3 ? atoi(argv[3]) : 20;
+  const int read_length = 100;
+
+  srand(47);
+  char alph[] = "ACGT";
+  string node1, node2;
+  for (int i = 0; i < node_length; i++) {
+    node1 += alph[rand()%4];
+    node2 += alph[rand()%4];
+  }
+  stringstream graph;
+  graph << "2\t1000\t41\t1\n";
+  graph << "NODE\t1\t" << node1.size() << "\t0\t0\n" << node1 << endl << ReverseSeq(node1) << endl;
+  graph << "NODE\t2\t" << node2.size() << "\t0\t0\n" << node2 << endl << ReverseSeq(node2) << endl;
+  Graph *g = LoadGraph(graph);
+
+  stringstream reads;
+  for (int i = 0; i < num_reads; i++) {
+    const string& node = i % 2 ? node1 : node2;
+    string read = node.substr(rand() % (node_length - read_length), read_length);
+    for (int j = rand() % 3; j > 0; j--) {
+      read[rand() % read_length] = alph[rand()%4];
+    }
+    reads << "@r" << i << endl << read << endl << "+" << endl << read << endl;
+  }
+  ReadSet<> rs;
+  rs.LoadReadSet(reads);
+
+  vector<Path> one({Path({g->nodes_[0]})});
+  vector<Path> two({Path({g->nodes_[0]}), Path({g->nodes_[2]})});
+  for (bool log_space: {false, true}) {
+    SingleReadProbabilityCalculator calculator(&rs, 0.01, -10, -0.7, 0, 0,
+                                               PathAligner::kDefaultCacheBytes,
+                                               false, log_space);
+    ProbabilityChange change;
+    calculator.GetPathsProbability(one, change);
+    calculator.ApplyProbabilityChange(change);
+    // Warm up the alignment cache
+    calculator.GetPathsProbability(two, change);
+
+    auto start = chrono::steady_clock::now();
+    double prob = 0;
+    for (int i = 0; i < iterations; i++) {
+      prob = calculator.GetPathsProbability(two, change);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("%s: %.3f ms per iteration, %d alignments, probability %.6f\n",
+           log_space ? "log space" : "linear", seconds * 1000 / iterations,
+           (int) change.added_alignments.size(), prob);
+  }
+}
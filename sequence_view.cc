@@ -0,0 +1,56 @@
+#include "sequence_view.h"
+#include <cstring>
+
+void SequenceView::CopyTo(int start, int length, char* out) const {
+  int i = upper_bound(starts_.begin(), starts_.end(), start) - starts_.begin() - 1;
+  for (; length > 0; i++) {
+    const Segment& s = segments_[i];
+    int offset = start - starts_[i];
+    int count = min(length, s.length - offset);
+    if (s.reverse_complement) {
+      // Bases [offset, offset + count) of reverse complement are complements
+      // of data[length - offset - count, length - offset)
+      ReverseComplement(s.data + s.length - offset - count, count, out);
+    } else {
+      memcpy(out, s.data + offset, count);
+    }
+    out += count;
+    start += count;
+    length -= count;
+  }
+}
+
+string SequenceView::substr(int start, int length) const {
+  string ret(length, 'N');
+  if (length > 0) {
+    CopyTo(start, length, &ret[0]);
+  }
+  return ret;
+}
+
+SequenceView SequenceView::SubView(int start, int length) const {
+  SequenceView ret;
+  int i = upper_bound(starts_.begin(), starts_.end(), start) - starts_.begin() - 1;
+  for (; length > 0; i++) {
+    const Segment& s = segments_[i];
+    int offset = start - starts_[i];
+    int count = min(length, s.length - offset);
+    // Bases [offset, offset + count) of reverse complemented segment come
+    // from the other end of its data
+    const char* data = s.reverse_complement ? s.data + s.length - offset - count :
+        s.data + offset;
+    ret.Append(data, count, s.reverse_complement);
+    start += count;
+    length -= count;
+  }
+  return ret;
+}
+
+SequenceView SequenceView::GetReverseComplement() const {
+  SequenceView ret;
+  for (int i = segments_.size() - 1; i >= 0; i--) {
+    const Segment& s = segments_[i];
+    ret.Append(s.data, s.length, !s.reverse_complement);
+  }
+  return ret;
+}
@@ -0,0 +1,88 @@
+#ifndef SEQUENCE_VIEW_H__
+#define SEQUENCE_VIEW_H__
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "util.h"
+
+using namespace std;
+
+// Sequence made of pieces of other strings (e.g. node sequences of a path)
+// without copying them. Pieces can be taken reverse complemented. The
+// strings must outlive the view.
+class SequenceView {
+ public:
+  SequenceView() : size_(0) {}
+
+  void Append(const char* data, int length, bool reverse_complement = false) {
+    if (length <= 0) return;
+    segments_.push_back(Segment(data, length, reverse_complement));
+    starts_.push_back(size_);
+    size_ += length;
+  }
+
+  void Append(const string& s) {
+    Append(s.data(), s.size());
+  }
+
+  int size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  // Logarithmic in number of pieces, use ForEach for scans
+  char operator[](int pos) const {
+    int i = upper_bound(starts_.begin(), starts_.end(), pos) - starts_.begin() - 1;
+    return segments_[i].Get(pos - starts_[i]);
+  }
+
+  // Calls f(base) for every base in order
+  template<class F>
+  void ForEach(F f) const {
+    for (auto &s: segments_) {
+      for (int i = 0; i < s.length; i++) {
+        f(s.Get(i));
+      }
+    }
+  }
+
+  // Copies bases [start, start + length) to out
+  void CopyTo(int start, int length, char* out) const;
+
+  string substr(int start, int length) const;
+
+  string str() const {
+    return substr(0, size_);
+  }
+
+  // View of bases [start, start + length), pointing to the same strings
+  SequenceView SubView(int start, int length) const;
+
+  // View of the reverse complement, pointing to the same strings
+  SequenceView GetReverseComplement() const;
+
+ private:
+  struct Segment {
+    Segment(const char* data_, int length_, bool reverse_complement_) :
+        data(data_), length(length_), reverse_complement(reverse_complement_) {}
+
+    char Get(int pos) const {
+      return reverse_complement ? ReverseBase(data[length - 1 - pos]) : data[pos];
+    }
+
+    const char* data;
+    int length;
+    bool reverse_complement;
+  };
+
+  vector<Segment> segments_;
+  // Position of the first base of every segment
+  vector<int> starts_;
+  int size_;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#include "sequence_view.h"
+#include <gtest/gtest.h>
+
+TEST(SequenceViewTest, ViewTest) {
+  string a = "ACGGT";
+  string b = "TTAC";
+  SequenceView view;
+  view.Append(a);
+  view.Append(b.data(), b.size(), true);
+  view.Append(a.data() + 1, 2);
+  string expected = a + ReverseSeq(b) + a.substr(1, 2);
+  ASSERT_EQ(expected.size(), view.size());
+  EXPECT_EQ(expected, view.str());
+  for (int i = 0; i < view.size(); i++) {
+    EXPECT_EQ(expected[i], view[i]);
+  }
+  string scanned;
+  view.ForEach([&](char c) { scanned += c; });
+  EXPECT_EQ(expected, scanned);
+  for (int start = 0; start < view.size(); start++) {
+    for (int length = 0; start + length <= view.size(); length++) {
+      EXPECT_EQ(expected.substr(start, length), view.substr(start, length));
+      EXPECT_EQ(expected.substr(start, length), view.SubView(start, length).str());
+    }
+  }
+  EXPECT_EQ(ReverseSeq(expected), view.GetReverseComplement().str());
+  EXPECT_EQ(expected, view.GetReverseComplement().GetReverseComplement().str());
+}
+
+TEST(SequenceViewTest, EmptyTest) {
+  SequenceView view;
+  view.Append("");
+  EXPECT_TRUE(view.empty());
+  EXPECT_EQ("", view.str());
+}
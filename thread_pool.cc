@@ -0,0 +1,78 @@
+#include "thread_pool.h"
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(int num_threads) : stop_(false) {
+  for (int i = 1; i < num_threads; i++) {
+    workers_.push_back(thread(&ThreadPool::WorkerLoop, this));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    unique_lock<mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto &w: workers_) {
+    w.join();
+  }
+}
+
+void ThreadPool::WorkerLoop() {
+  while (true) {
+    function<void()> task;
+    {
+      unique_lock<mutex> lock(mutex_);
+      cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+      if (tasks_.empty()) return;
+      task = tasks_.front();
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+namespace {
+
+struct ParallelForState {
+  ParallelForState(int n_, const function<void(int)>* f_) :
+      n(n_), f(f_), next(0), done(0) {}
+
+  // Takes items until none are left. f is only touched while some item is
+  // unfinished, so late helpers never use it after ParallelFor returned.
+  void Run() {
+    int i;
+    while ((i = next++) < n) {
+      (*f)(i);
+      if (++done == n) {
+        unique_lock<mutex> lock(m);
+        cv.notify_all();
+      }
+    }
+  }
+
+  int n;
+  const function<void(int)>* f;
+  atomic<int> next;
+  atomic<int> done;
+  mutex m;
+  condition_variable cv;
+};
+
+}
+
+void ThreadPool::ParallelFor(int n, const function<void(int)>& f) {
+  shared_ptr<ParallelForState> state = make_shared<ParallelForState>(n, &f);
+  int helpers = min((int) workers_.size(), n - 1);
+  if (helpers > 0) {
+    unique_lock<mutex> lock(mutex_);
+    for (int i = 0; i < helpers; i++) {
+      tasks_.push_back([state] { state->Run(); });
+    }
+  }
+  cv_.notify_all();
+  state->Run();
+  unique_lock<mutex> lock(state->m);
+  state->cv.wait(lock, [&state] { return state->done == state->n; });
+}
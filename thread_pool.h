@@ -0,0 +1,53 @@
+#ifndef THREAD_POOL_H__
+#define THREAD_POOL_H__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Fixed set of worker threads. Calling thread takes part in ParallelFor,
+// so ParallelFor can be called from inside of other ParallelFor.
+class ThreadPool {
+ public:
+  // num_threads includes the calling thread, so num_threads - 1 workers
+  // are started.
+  ThreadPool(int num_threads);
+  ~ThreadPool();
+
+  int num_threads() const {
+    return workers_.size() + 1;
+  }
+
+  // Calls f(i) for every i in [0, n) and returns after all calls finished.
+  void ParallelFor(int n, const function<void(int)>& f);
+
+ private:
+  ThreadPool(const ThreadPool&);
+  ThreadPool& operator=(const ThreadPool&);
+
+  void WorkerLoop();
+
+  vector<thread> workers_;
+  mutex mutex_;
+  condition_variable cv_;
+  deque<function<void()>> tasks_;
+  bool stop_;
+};
+
+// Runs f(i) for i in [0, n) in pool, or serially if pool is NULL.
+inline void ParallelFor(ThreadPool* pool, int n, const function<void(int)>& f) {
+  if (pool == NULL || pool->num_threads() == 1 || n <= 1) {
+    for (int i = 0; i < n; i++) {
+      f(i);
+    }
+    return;
+  }
+  pool->ParallelFor(n, f);
+}
+
+#endif
@@ -0,0 +1,28 @@
+#include "thread_pool.h"
+#include <gtest/gtest.h>
+#include <atomic>
+
+TEST(ThreadPoolTest, ParallelForTest) {
+  ThreadPool pool(4);
+  EXPECT_EQ(4, pool.num_threads());
+  vector<int> out(1000, 0);
+  pool.ParallelFor(out.size(), [&out](int i) { out[i] = i * 2; });
+  for (size_t i = 0; i < out.size(); i++) {
+    EXPECT_EQ(i * 2, out[i]);
+  }
+}
+
+TEST(ThreadPoolTest, NestedParallelForTest) {
+  ThreadPool pool(3);
+  atomic<int> sum(0);
+  pool.ParallelFor(10, [&](int i) {
+    pool.ParallelFor(10, [&](int j) { sum += j; });
+  });
+  EXPECT_EQ(450, sum);
+}
+
+TEST(ThreadPoolTest, NoPoolTest) {
+  vector<int> out(10, 0);
+  ParallelFor(NULL, out.size(), [&out](int i) { out[i] = i; });
+  EXPECT_EQ(9, out[9]);
+}
@@ -1,6 +1,7 @@
 #ifndef UTIL_H__
 #define UTIL_H__
 
+#include <random>
 #include <string>
 
 using namespace std;
@@ -13,11 +14,52 @@ inline char ReverseBase(char c) {
   return 'N';
 }
 
-inline string ReverseSeq(const string& s) {
-  string ret;
-  for (int i = s.size() - 1; i >= 0; i--) {
-    ret += ReverseBase(s[i]);
+// 2-bit code of base, -1 for anything else than ACGT
+inline int BaseToBits(char c) {
+  if (c == 'A') return 0;
+  if (c == 'C') return 1;
+  if (c == 'G') return 2;
+  if (c == 'T') return 3;
+  return -1;
+}
+
+inline char BitsToBase(int x) {
+  return "ACGT"[x & 3];
+}
+
+// Uniformly random integer in [0, n)
+inline int RandomInt(default_random_engine& generator, int n) {
+  return uniform_int_distribution<int>(0, n - 1)(generator);
+}
+
+// Complement of every char, 'N' for anything else than ACGT
+class ComplementTable {
+ public:
+  ComplementTable() {
+    for (int i = 0; i < 256; i++) {
+      table_[i] = ReverseBase(i);
+    }
   }
+
+  char operator[](char c) const {
+    return table_[(unsigned char) c];
+  }
+
+ private:
+  char table_[256];
+};
+
+// Writes reverse complement of s[0, length) to out, which must not overlap s
+inline void ReverseComplement(const char* s, int length, char* out) {
+  static const ComplementTable complement;
+  for (int i = 0; i < length; i++) {
+    out[length - 1 - i] = complement[s[i]];
+  }
+}
+
+inline string ReverseSeq(const string& s) {
+  string ret(s.size(), 'N');
+  ReverseComplement(s.data(), s.size(), &ret[0]);
   return ret;
 }
 
@@ -4,3 +4,8 @@
 TEST(ReverseTest, ReverseTest) {
   EXPECT_EQ(string("TTACG"), ReverseSeq("CGTAA"));
 }
+
+TEST(ReverseTest, ReverseNonAcgtTest) {
+  EXPECT_EQ(string("NTNACGN"), ReverseSeq("xCGTnAy"));
+  EXPECT_EQ(string(""), ReverseSeq(""));
+}